@@ -3,17 +3,32 @@
  * @brief Main game logic for Beggar My Neighbour card game.
  * The game is played with a standard deck of 52 cards, divided evenly among a number of players. Each player's hand is
  * kept in a queue. Players take turns playing the top card of their queue, and the winner is the player who collects
- * all of the cards.
+ * all of the cards. A game in progress is kept in a Game struct, so it can be played a few turns at a time.
  * @author Josh
  * 
 */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <gsl/gsl_rng.h>
 #include "shuffle.h"
 #include "time.h"
 #include "queue.h"
+#include "beggar.h"
+
+/**
+ * @brief Function to find the penalty the next player owes for the card on top of the pile.
+ * A jack (11) costs 1 card, a queen (12) 2, a king (13) 3 and an ace (14) 4.
+ * @param pile Queue pointer to the pile.
+ * @return The number of cards to pay, or 0 if the pile is empty or its top card is not a penalty card.
+*/
+static int penalty_due(Queue *pile) {
+    if (queue_is_empty(pile) || queue_peek_back(pile) < 11) {
+        return 0;
+    }
+    return queue_peek_back(pile) - 10;
+}
 
 /**
  * @brief Function to play one turn of the game for a player.
@@ -28,23 +43,11 @@ Queue *take_turn(Queue *player, Queue *pile) {
     if (queue_is_empty(player)) {
         return reward;
     }
-    int paying_penalty = 0;
-    int penalty = 1;
     // Determine the penalty based on the top card on the pile
-    if (queue_is_empty(pile)) {
+    int penalty = penalty_due(pile);
+    int paying_penalty = penalty > 0;
+    if (!paying_penalty) {
         penalty = 1;
-    } else if (queue_peek_back(pile) == 11) {
-        paying_penalty = 1;
-        penalty = 1;
-    } else if (queue_peek_back(pile) == 12) {
-        paying_penalty = 1;
-        penalty = 2;
-    } else if (queue_peek_back(pile) == 13) {
-        penalty = 3;
-        paying_penalty = 1;
-    } else if (queue_peek_back(pile) == 14) {
-        penalty = 4;
-        paying_penalty = 1;
     }
     for (int i = 0; i < penalty; i++) {
         if(!queue_is_empty(player)){
@@ -98,144 +101,206 @@ int finished(Queue **players, int Nplayers) {
 }
 
 /**
- * @brief The function beggar simulates the game of Beggar My Neighbour
- * @param Nplayers Number of players in the game
- * @param deck Pointer to an array of integers representing the deck of cards
- * @param talkative Integer flag to indicate whether to print game details
- * @return The number of turns played in the game
- * This function takes in the number of players, a deck of cards and a talkative flag
- * as input and simulates the game of Beggar My Neighbour according to the rules of the game.
- * It returns the number of turns played in the game. The deck is shuffled using the shuffle()
- * function from shuffle.c. Players' hands are filled by dealing out the cards from the deck.
- * The game continues until only one player has all the cards. During each turn, the current
- * player lays down a card and performs any required actions, such as paying a penalty, if the
- * card is a penalty card. The turn then passes to the next player. If a player has no cards left,
- * they are skipped. The game continues until only one player has all the cards.
+ * @brief Function to start a game by dealing a deck out to the players.
+ * @param Nplayers Number of players in the game.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @param talkative Integer flag to indicate whether game_step() prints each turn.
+ * @return Pointer to the new game, or NULL if memory could not be allocated.
 */
-int beggar(int Nplayers, int *deck, int talkative) {
-    // Initialize variables
+Game *game_init(int Nplayers, const int *deck, int talkative) {
     int deck_length = 52;
-    /*
-    In the shuffle.c provided, if the seed value is negative, then time(NULL) is used to seed the random number generator. 
-    This is because time(NULL) returns the current time in seconds since January 1, 1970, which is different for each program run, 
-    ensuring that the random number sequence produced by the generator will be different each time the program is run. 
-    However, if seed is a non-negative integer, then it is used as the seed value for the random number generator. 
-    This can be useful if you want to produce the same sequence of random numbers each time the program is run, by using the same seed value.
-    */
-    int seed = 10; 
-    // shuffle deck using the shuffle function from shuffle.c
-    shuffle(deck, deck_length, seed);
-
-    printf("Deck After Shuffle: ");
-    for(int i = 0; i < 52; i++){
-        printf(" %d", deck[i]);
+    Game *game = malloc(sizeof(Game));
+    if (game == NULL) {
+        printf("Error: failed to allocate memory for the game\n");
+        return NULL;
     }
-    printf("\n");
-    // int deck_length = sizeof(deck) / sizeof(int);
-    Queue **players = malloc(Nplayers * sizeof(Queue *));
-    if (players == NULL) {
+    game->players = calloc(Nplayers, sizeof(Queue *));
+    game->pile = queue_create();
+    if (game->players == NULL || game->pile == NULL) {
         printf("Error: failed to allocate memory for players\n");
-        exit(EXIT_FAILURE);
+        free(game->players);
+        free(game->pile);
+        free(game);
+        return NULL;
     }
+    game->Nplayers = Nplayers;
     for (int i = 0; i < Nplayers; i++) {
-        players[i] = queue_create();
+        game->players[i] = queue_create();
+        if (game->players[i] == NULL) {
+            game_free(game);
+            return NULL;
+        }
     }
 
     // Fill the players' hands
     for (int i = 0; i < deck_length; i++) {
         int player_index = i % Nplayers;
-        queue_enqueue(players[player_index], deck[i]);
+        queue_enqueue(game->players[player_index], deck[i]);
     }
 
-    // Initialize other variables
-    Queue *pile = queue_create();
-    int penalty = 0;
-    int turn = 0;
-    int penalty_player = -1;
-    int current_player = 0;
-    int paying_penalty = 0;
-    int false_turn = 0;
-    
-    // Loop until only one player have all the cards, we are not suppose to check who won, we just have to return the no. of turns
-    while (!finished(players, Nplayers)) {
-        current_player = turn % Nplayers;
-        turn++;
+    game->turn = 0;
+    game->false_turn = 0;
+    game->penalty_player = -1;
+    game->talkative = talkative;
+    game->done = finished(game->players, Nplayers);
+    return game;
+}
+
+/**
+ * @brief Function to print the state of a game before a turn.
+ * @param game Pointer to the game.
+ * @param current_player The player whose turn it is.
+*/
+static void print_turn(const Game *game, int current_player) {
+    int penalty = penalty_due(game->pile);
+    printf("\nTurn %d Player %d to lay %d card\n", game->turn, current_player, penalty > 0 ? penalty : 1);
+    if (penalty > 0) {
+        printf("Player %d is paying the penalty of %d cards\n\n", current_player, penalty);
+    }
+    printf("Pile: ");
+    queue_print(game->pile);
+    printf("\n");
+    for (int i = 0; i < game->Nplayers; i++) {
+        printf("Player %d: ", i);
+        queue_print(game->players[i]);
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Function to play the next turns of a game.
+ * @param game Pointer to the game.
+ * @param n_turns Maximum number of turns to play.
+ * @return 1 if the game is over, 0 otherwise.
+*/
+int game_step(Game *game, int n_turns) {
+    int played = 0;
+    // Loop until only one player have all the cards, we are not suppose to check who won, we just have to count the turns
+    while (!game->done && played < n_turns) {
+        int current_player = game->turn % game->Nplayers;
+        game->turn++;
 
         //if current player is the only player left (paying penalty to herself)
-        if (penalty_player == current_player){
+        if (game->penalty_player == current_player) {
+            game->done = 1;
             break;
         }
         // Check if current player has no cards left
-        if (queue_is_empty(players[current_player])) {
+        if (queue_is_empty(game->players[current_player])) {
             // current player is already out, so we are not counting it a turn. 
-            false_turn++;
+            game->false_turn++;
             continue;
         }
-
-        // Determine the penalty based on the top card on the pile
-        if (queue_is_empty(pile)) {
-            penalty = 1;
-        } else if (queue_peek_back(pile) == 11) {
-            paying_penalty = 1;
-            penalty = 1;
-        } else if (queue_peek_back(pile) == 12) {
-            paying_penalty = 1;
-            penalty = 2;
-        } else if (queue_peek_back(pile) == 13) {
-            penalty = 3;
-            paying_penalty = 1;
-        } else if (queue_peek_back(pile) == 14) {
-            penalty = 4;
-            paying_penalty = 1;
-        }
+        played++;
 
         // Print current turn and player
-        if (talkative != 0) {
-            printf("\nTurn %d Player %d to lay %d card\n", turn, current_player, penalty);
-            if (paying_penalty == 1) {
-                printf("Player %d is paying the penalty of %d cards\n\n", current_player, penalty);
-            }printf("Pile: ");
-            queue_print(pile);
-            printf("\n");
-            for (int i = 0; i < Nplayers; i++) {
-                printf("Player %d: ", i);
-                queue_print(players[i]);
-                printf("\n");
-            }
+        if (game->talkative != 0) {
+            print_turn(game, current_player);
         }
 
         // Call take_turn() and store the result in reward
-        Queue *reward = take_turn(players[current_player], pile);
-        
+        Queue *reward = take_turn(game->players[current_player], game->pile);
+
         // If reward is not empty, add all values to the previous player's queue who laid the penalty card
         if (!queue_is_empty(reward)) {
             while (!queue_is_empty(reward)) {
                 int card = queue_dequeue(reward);
-                queue_enqueue(players[penalty_player], card);
+                queue_enqueue(game->players[game->penalty_player], card);
             }
-            penalty_player = -1; //reset penalty player
-        } else{
+            game->penalty_player = -1; //reset penalty player
+        } else {
             // pile won't be empty if it comes in else because either pile can be empty or reward (both can't be empty at same time)
             // if current player laid a penalty card, she'll receive the penalty from next player
-            if(queue_peek_back(pile) >= 11){
-                penalty_player = current_player;
+            if (queue_peek_back(game->pile) >= 11) {
+                game->penalty_player = current_player;
             }
         }
+        queue_destroy(reward);
 
-
+        game->done = finished(game->players, game->Nplayers);
     }
+    return game->done;
+}
+
+/**
+ * @brief Function to check if a game is over.
+ * @param game Pointer to the game.
+ * @return 1 if the game is over, 0 otherwise.
+*/
+int game_done(const Game *game) {
+    return game->done;
+}
 
+/**
+ * @brief Function to get the number of turns played in a game so far.
+ * @param game Pointer to the game.
+ * @return The number of turns played, not counting the ones skipped for players who are out.
+*/
+int game_turns(const Game *game) {
+    // Subtracting the false turns
+    return game->turn - game->false_turn;
+}
+
+/**
+ * @brief Function to free the memory used by a game.
+ * @param game Pointer to the game, or NULL.
+*/
+void game_free(Game *game) {
+    if (game == NULL) {
+        return;
+    }
     // Free the memory used by the players' hands
-    for (int i = 0; i < Nplayers; i++) {
-        queue_destroy(players[i]);
+    for (int i = 0; i < game->Nplayers; i++) {
+        if (game->players[i] != NULL) {
+            queue_destroy(game->players[i]);
+        }
     }
-    free(players);
+    free(game->players);
 
     // Free the memory used by the pile
-    queue_destroy(pile);
+    queue_destroy(game->pile);
+    free(game);
+}
 
-    // Subtracting the false turns
-    return turn - false_turn;
+/**
+ * @brief The function beggar simulates the game of Beggar My Neighbour
+ * @param Nplayers Number of players in the game
+ * @param deck Pointer to an array of integers representing the deck of cards
+ * @param talkative Integer flag to indicate whether to print game details
+ * @return The number of turns played in the game
+ * This function shuffles the deck, deals it out with game_init() and plays the game to the end with game_step().
+*/
+int beggar(int Nplayers, int *deck, int talkative) {
+    // Initialize variables
+    int deck_length = 52;
+    /*
+    In the shuffle.c provided, if the seed value is negative, then time(NULL) is used to seed the random number generator. 
+    This is because time(NULL) returns the current time in seconds since January 1, 1970, which is different for each program run, 
+    ensuring that the random number sequence produced by the generator will be different each time the program is run. 
+    However, if seed is a non-negative integer, then it is used as the seed value for the random number generator. 
+    This can be useful if you want to produce the same sequence of random numbers each time the program is run, by using the same seed value.
+    */
+    int seed = 10; 
+    // shuffle deck using the shuffle function from shuffle.c
+    shuffle(deck, deck_length, seed);
+
+    if (talkative != 0) {
+        printf("Deck After Shuffle: ");
+        for (int i = 0; i < deck_length; i++) {
+            printf(" %d", deck[i]);
+        }
+        printf("\n");
+    }
+
+    Game *game = game_init(Nplayers, deck, talkative);
+    if (game == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    while (!game_step(game, INT_MAX)) {
+    }
+    int turns = game_turns(game);
+    game_free(game);
+    return turns;
 }
 
 /* Instructions for running the program:
@@ -243,8 +308,9 @@ int beggar(int Nplayers, int *deck, int talkative) {
  * gcc -c beggar.c -o beggar.o 
  * gcc beggar.c shuffle.c single.c queue.c -lgsl -lgslcblas -lm -o single
  * This function implements take turns (to take turn for current player on each turn), 
- * finished (to check if game is finished) and beggar (complete algorithm which uses 
- * finished and take turns and finally return number of turns)
+ * finished (to check if game is finished), the game_init/game_step/game_done/game_free
+ * calls (to play a game a few turns at a time) and beggar (complete algorithm which uses
+ * them and finally return number of turns)
 */
 
 
@@ -9,6 +9,28 @@
 #include "time.h"
 #include "queue.h"
 
+/** The rules the game is played by, recorded with the results cached by byn. */
+#define BEGGAR_RULES "52 cards; J, Q, K, A cost 1, 2, 3, 4 cards; empty hands skipped"
+
+/** Version of the game code: raise it whenever a change alters how many turns a deal takes, so cached results are not reused. */
+#define BEGGAR_VERSION 1
+
+/**
+ * @brief Struct holding the state of one game between turns.
+ * A game is started with game_init(), played a few turns at a time with game_step() until game_done() says it is over,
+ * and freed with game_free(), so a caller can keep many games going at once and interleave them.
+*/
+typedef struct Game {
+    int Nplayers; /**< The number of players in the game. */
+    Queue **players; /**< The players' hands, one queue per player. */
+    Queue *pile; /**< The cards laid on the table. */
+    int turn; /**< The number of turns taken so far, counting the ones skipped for players who are out. */
+    int false_turn; /**< The number of turns skipped because the player was out. */
+    int penalty_player; /**< The player who laid the last penalty card and will collect the pile, or -1. */
+    int talkative; /**< Integer flag to indicate whether to print each turn. */
+    int done; /**< 1 once the game is over, 0 otherwise. */
+} Game;
+
 /**
  * @brief Function to play one turn of the game for a player.
  * @param player Queue pointer to the player queue whose turn it is to play.
@@ -26,6 +48,45 @@ Queue *take_turn(Queue *player, Queue *pile);
 */
 int finished(Queue **players, int Nplayers);
 
+/**
+ * @brief Function to start a game by dealing a deck out to the players.
+ * The deck is dealt as it is, one card to each player in turn, so it should be shuffled first.
+ * @param Nplayers Number of players in the game.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @param talkative Integer flag to indicate whether game_step() prints each turn.
+ * @return Pointer to the new game, or NULL if memory could not be allocated.
+*/
+Game *game_init(int Nplayers, const int *deck, int talkative);
+
+/**
+ * @brief Function to play the next turns of a game.
+ * Turns skipped for players who are out do not count towards n_turns, just as they do not count towards game_turns().
+ * @param game Pointer to the game.
+ * @param n_turns Maximum number of turns to play.
+ * @return 1 if the game is over, 0 otherwise.
+*/
+int game_step(Game *game, int n_turns);
+
+/**
+ * @brief Function to check if a game is over.
+ * @param game Pointer to the game.
+ * @return 1 if the game is over, 0 otherwise.
+*/
+int game_done(const Game *game);
+
+/**
+ * @brief Function to get the number of turns played in a game so far.
+ * @param game Pointer to the game.
+ * @return The number of turns played, not counting the ones skipped for players who are out.
+*/
+int game_turns(const Game *game);
+
+/**
+ * @brief Function to free the memory used by a game.
+ * @param game Pointer to the game, or NULL.
+*/
+void game_free(Game *game);
+
 /**
  * @brief The function beggar simulates the game of Beggar My Neighbour
  * @param Nplayers Number of players in the game
@@ -35,7 +96,7 @@ int finished(Queue **players, int Nplayers);
  * This function takes in the number of players, a deck of cards and a talkative flag
  * as input and simulates the game of Beggar My Neighbour according to the rules of the game.
  * It returns the number of turns played in the game. The deck is shuffled using the shuffle()
- * function from shuffle.c. Players' hands are filled by dealing out the cards from the deck.
+ * function from shuffle.c, and printed if talkative is set. The game is then played with game_init() and game_step().
  * The game continues until only one player has all the cards. During each turn, the current
  * player lays down a card and performs any required actions, such as paying a penalty, if the
  * card is a penalty card. The turn then passes to the next player. If a player has no cards left,
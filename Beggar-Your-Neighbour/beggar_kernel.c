@@ -0,0 +1,157 @@
+/**
+ * @file beggar_kernel.c
+ * @brief Fast game simulators for Beggar My Neighbour.
+ * The rules are those of take_turn() and game_step() in beggar.c, and the turns are counted the same way. A hand
+ * never holds more than the 52 cards, so each is a ring buffer of 64 cards indexed with a mask, and the pile is a
+ * plain array, as it only ever grows until it is collected whole. The game is over when a player collects all the
+ * cards, which can only happen when a pile is collected, so that is the only place it is checked.
+ * @author Josh
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "beggar_kernel.h"
+
+#define DECK_SIZE 52 /**< The number of cards in the deck */
+#define HAND_SIZE 64 /**< The room in a hand: a power of 2 of at least DECK_SIZE */
+#define HAND_MASK (HAND_SIZE - 1) /**< Mask to wrap a position in a hand */
+#define MAX_PLAYERS 52 /**< The largest number of players the generic simulator handles */
+
+/**
+ * @brief Struct representing a hand of cards as a ring buffer.
+*/
+typedef struct {
+    unsigned char cards[HAND_SIZE]; /**< The cards, from front to back starting at front, wrapping around. */
+    int front; /**< The position of the front card. */
+    int size; /**< The number of cards in the hand. */
+} Hand;
+
+/**
+ * @brief Plays a dealt deck to the end.
+ * Always inlined, so that the instances generated by DEFINE_KERNEL get Nplayers as a constant.
+ * @param Nplayers Number of players in the game.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @return The number of turns the game took, not counting the ones skipped for players who are out.
+*/
+static inline __attribute__((always_inline)) int play(int Nplayers, const int *deck) {
+    Hand hands[MAX_PLAYERS];
+    unsigned char pile[DECK_SIZE];
+    int pile_size = 0;
+
+    // Fill the players' hands
+    for (int i = 0; i < Nplayers; i++) {
+        hands[i].front = 0;
+        hands[i].size = 0;
+    }
+    for (int i = 0; i < DECK_SIZE; i++) {
+        Hand *hand = &hands[i % Nplayers];
+        hand->cards[hand->size++] = (unsigned char) deck[i];
+    }
+    if (Nplayers == 1) {
+        return 0; // the only player holds every card
+    }
+
+    int turn = 0;
+    int false_turn = 0;
+    int penalty_player = -1;
+    int current_player = Nplayers - 1;
+    for (;;) {
+        current_player = current_player + 1 == Nplayers ? 0 : current_player + 1;
+        turn++;
+
+        //if current player is the only player left (paying penalty to herself)
+        if (penalty_player == current_player) {
+            break;
+        }
+        Hand *hand = &hands[current_player];
+        if (hand->size == 0) {
+            false_turn++;
+            continue;
+        }
+
+        // Determine the penalty based on the top card on the pile, as take_turn() does
+        int top = pile_size > 0 ? pile[pile_size - 1] : 0;
+        int paying_penalty = top >= 11;
+        int penalty = paying_penalty ? top - 10 : 1;
+        int collect = paying_penalty;
+        for (int i = 0; i < penalty && hand->size > 0; i++) {
+            int card = hand->cards[hand->front];
+            hand->front = (hand->front + 1) & HAND_MASK;
+            hand->size--;
+            pile[pile_size++] = (unsigned char) card;
+            if (!paying_penalty || card >= 11) {
+                collect = 0;
+                break;
+            }
+        }
+
+        if (collect) {
+            // The player who laid the penalty card takes the pile, bottom card first
+            Hand *winner = &hands[penalty_player];
+            for (int i = 0; i < pile_size; i++) {
+                winner->cards[(winner->front + winner->size + i) & HAND_MASK] = pile[i];
+            }
+            winner->size += pile_size;
+            pile_size = 0;
+            penalty_player = -1;
+            if (winner->size == DECK_SIZE) {
+                break;
+            }
+        } else if (pile[pile_size - 1] >= 11) {
+            penalty_player = current_player;
+        }
+    }
+
+    // Subtracting the false turns
+    return turn - false_turn;
+}
+
+/**
+ * @brief Defines the simulator specialised for a number of players.
+ * @param N The number of players.
+*/
+#define DEFINE_KERNEL(N)                        \
+    static int play_##N(const int *deck) {      \
+        return play(N, deck);                   \
+    }
+
+DEFINE_KERNEL(2)
+DEFINE_KERNEL(3)
+DEFINE_KERNEL(4)
+DEFINE_KERNEL(5)
+DEFINE_KERNEL(6)
+
+#undef DEFINE_KERNEL
+
+/**
+ * @brief Function to play a dealt deck to the end, for any number of players.
+ * @param Nplayers Number of players in the game, from 1 to 52.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @return The number of turns the game took, as game_turns() would report it.
+*/
+int beggar_play(int Nplayers, const int *deck) {
+    if (Nplayers < 1 || Nplayers > MAX_PLAYERS) {
+        printf("Error: the number of players must be between 1 and %d\n", MAX_PLAYERS);
+        exit(EXIT_FAILURE);
+    }
+    return play(Nplayers, deck);
+}
+
+/**
+ * @brief Function to find the simulator specialised for a number of players.
+ * @param Nplayers Number of players in the game.
+ * @return The simulator for 2 to 6 players, or NULL for other numbers.
+*/
+GameKernel beggar_kernel(int Nplayers) {
+    static const GameKernel kernels[] = {NULL, NULL, play_2, play_3, play_4, play_5, play_6};
+    if (Nplayers < 0 || Nplayers >= (int) (sizeof(kernels) / sizeof(kernels[0]))) {
+        return NULL;
+    }
+    return kernels[Nplayers];
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -O2 -c beggar_kernel.c -o beggar_kernel.o
+ * statistics.c picks the simulator for each number of players once with beggar_kernel(), and falls back on
+ * beggar_play() for the numbers without one.
+ */
@@ -0,0 +1,36 @@
+/**
+ * @file beggar_kernel.h
+ * Header file for the fast game simulators used by the statistics.
+ * They play a dealt deck to the end exactly as game_step() does, and return the same number of turns, but keep the
+ * hands as ring buffers of cards in a stack array instead of linked queues. Simulators specialised for 2 to 6
+ * players are generated from one macro, so the number of players is a constant the compiler can fold into the seat
+ * rotation; other numbers of players use the generic simulator.
+ * @author Josh
+*/
+
+#ifndef BEGGAR_KERNEL_H
+#define BEGGAR_KERNEL_H
+
+/**
+ * @brief A simulator specialised for one number of players.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @return The number of turns the game took.
+*/
+typedef int (*GameKernel)(const int *deck);
+
+/**
+ * @brief Function to play a dealt deck to the end, for any number of players.
+ * @param Nplayers Number of players in the game, from 1 to 52.
+ * @param deck Pointer to an array of the 52 cards to deal.
+ * @return The number of turns the game took, as game_turns() would report it.
+*/
+int beggar_play(int Nplayers, const int *deck);
+
+/**
+ * @brief Function to find the simulator specialised for a number of players.
+ * @param Nplayers Number of players in the game.
+ * @return The simulator for 2 to 6 players, or NULL for other numbers, which beggar_play() handles.
+*/
+GameKernel beggar_kernel(int Nplayers);
+
+#endif /* BEGGAR_KERNEL_H */
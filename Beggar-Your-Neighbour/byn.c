@@ -3,34 +3,76 @@
  * @brief Main program for running the Beggar Your Neighbor game simulation
  * This program runs the Beggar Your Neighbor game simulation with varying numbers of players, using the statistics function to
  * calculate the shortest game, longest game, and average game length for each number of players. The results are written to a
- * file named "statistics.txt".
+ * file named "statistics.txt", with the number of games played and how precisely the average is known.
 @author Your Name
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "queue.h"
 #include "statistics.h"
 
 #define MAX_PLAYERS 52 /**< Maximum number of players that can play the game */
 #define MIN_PLAYERS 2 /**< Minimum number of players that can play the game */
 #define NUM_TRIALS 100 /**< Minimum number of trials to run the simulation */
+#define MAX_TRIALS 100000 /**< Default maximum number of trials to run the simulation with -p */
+#define SEED 10 /**< Default seed of the games */
+
+/**
+ * @brief Prints how to run the program
+ * @param name The name the program was run as
+*/
+static void usage(const char *name) {
+    printf("Usage: %s [-p precision] [-M max_trials] [-s seed] [-C cache_dir] max_number_of_players num_trials\n", name);
+    printf("  -p precision   keep playing until the average is known to within this fraction (e.g. 0.01), with\n");
+    printf("                 num_trials as the least number of games for each number of players\n");
+    printf("  -M max_trials  the most games to play for each number of players with -p (default %d)\n", MAX_TRIALS);
+    printf("  -s seed        the seed of the games (default %d); a negative seed uses the time\n", SEED);
+    printf("  -C cache_dir   reuse the games played by earlier runs with the same seed, and keep the new ones there\n");
+}
 
 /**
  * @brief Main function that runs the Beggar Your Neighbor game simulation
  * The program takes two command line arguments - the maximum number of players and the number of trials to run for each number of players.
  * It calls the statistics function N = [2, Max number of players] times and writes the output to a file named "statistics.txt".
+ * With -p, the number of trials is the least number of games, and each number of players is played until the average
+ * is known to the given precision or -M games have been played. With -C, the games already played by earlier runs
+ * with the same seed are taken from the cache directory, so only the missing ones are played.
  * @param argc The number of command line arguments
  * @param argv An array of strings containing the command line arguments
  * @return Returns 0 if the program runs successfully, 1 if there is an error
 */
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        printf("Usage: byn max_number_of_players num_trials\n");
+    double precision = 0; /**< The relative precision wanted for the average, 0 for a fixed number of trials */
+    int max_trials = MAX_TRIALS; /**< The most trials to run with -p */
+    int seed = SEED; /**< The seed of the games */
+    const char *cache_dir = NULL; /**< The directory of the result cache, NULL for none */
+    const char *args[2];
+    int num_args = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            precision = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            max_trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (argv[i][0] != '-' && num_args < 2) {
+            args[num_args++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (num_args != 2) {
+        usage(argv[0]);
         return 1;
     }
 
-    int max_players = atoi(argv[1]); /**< The maximum number of players to run the simulation for */
-    int num_trials = atoi(argv[2]); /**< The number of trials to run the simulation for */
+    int max_players = atoi(args[0]); /**< The maximum number of players to run the simulation for */
+    int num_trials = atoi(args[1]); /**< The number of trials to run the simulation for */
 
     if (max_players > MAX_PLAYERS) {
         printf("Error: max number of players cannot exceed %d\n", MAX_PLAYERS);
@@ -38,7 +80,7 @@ int main(int argc, char *argv[]) {
     }
 
     if (max_players < MIN_PLAYERS) {
-        printf("Error: min number of players cannot be less than %d\n", MAX_PLAYERS);
+        printf("Error: min number of players cannot be less than %d\n", MIN_PLAYERS);
         return 1;
     }
 
@@ -46,6 +88,16 @@ int main(int argc, char *argv[]) {
         printf("Error: min number of trials should be at least %d\n", NUM_TRIALS);
         return 1;
     }
+
+    if (precision < 0 || precision >= 1) {
+        printf("Error: precision should be between 0 and 1\n");
+        return 1;
+    }
+
+    if (precision > 0 && max_trials < num_trials) {
+        printf("Error: max number of trials cannot be less than %d\n", num_trials);
+        return 1;
+    }
     
     FILE *file = fopen("statistics.txt", "w"); /**< File pointer to the output file "statistics.txt" */
     if (file == NULL) {
@@ -53,11 +105,17 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    fprintf(file, "Number of players, Shortest game, Longest game, Average game\n");
+    fprintf(file, "Number of players, Shortest game, Longest game, Average game, Trials, Precision\n");
 
     for (int i = 2; i <= max_players; i++) {
-        GameStats output = statistics(i, num_trials);
-        fprintf(file, "%d,\t\t\t\t\t %d, \t\t\t %d,\t\t %.2f\n\n", i, output.shortest, output.longest, output.average);
+        GameStats output = precision > 0 ? statistics_adaptive(i, precision, num_trials, max_trials, seed, cache_dir)
+                                         : statistics_adaptive(i, 0, num_trials, num_trials, seed, cache_dir);
+        fprintf(file, "%d,\t\t\t\t\t %d, \t\t\t %d,\t\t %.2f,\t\t %d,\t\t %.2f%%\n\n", i, output.shortest,
+                output.longest, output.average, output.trials, 100 * output.precision);
+        if (precision > 0) {
+            printf("%d players: average %.2f +/- %.2f%% after %d games%s\n", i, output.average,
+                   100 * output.precision, output.trials, output.precision > precision ? " (max trials reached)" : "");
+        }
     }
 
     fclose(file);
@@ -69,10 +127,16 @@ int main(int argc, char *argv[]) {
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
- * gcc beggar.c shuffle.c byn.c queue.c statistics.c -lgsl -lgslcblas -lm -o byn
+ * gcc -O2 beggar.c beggar_kernel.c shuffle.c byn.c queue.c statistics.c cell_cache.c -lgsl -lgslcblas -lm -o byn
  * 
  * To run the program, type the following command:
  * ./byn 3 100
+ * ./byn -p 0.02 -M 50000 10 100
+ * ./byn -C byn_cache 10 10000
  * 
  * The program will call the statistics function N = [2,  Max number of players] times and will write the output in statistics.txt file
+ * With -p, each number of players is played until the average is within the given fraction (here 2%) at 95% confidence,
+ * with at least num_trials and at most -M games; the games played and the precision reached are printed and written out
+ * With -C, a second run of the same sweep reads every result from byn_cache, and a run with more trials only plays
+ * the extra games
  */
\ No newline at end of file
@@ -0,0 +1,192 @@
+/**
+ * @file cell_cache.c
+ * Implementation of the on-disk cache of byn results.
+ * A cell's file is text: a format line, the description line, then one line per block of games giving its trials,
+ * shortest and longest game, and the sums of the moves and of their squares.
+ * @author Josh
+*/
+#define _DEFAULT_SOURCE /* flock, fsync */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cell_cache.h"
+
+#define CELL_FORMAT "byn-cell 1" /**< The first line of a cell's file */
+
+/**
+ * @brief Hash a cell's description into its key.
+ * @param description The description.
+ * @return The 64-bit FNV-1a hash of the description.
+*/
+unsigned long long cell_key(const char *description) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *c = (const unsigned char *) description; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Read the blocks of a cell's file, if it holds the cell's description.
+ * Reading stops at the first line that is not a complete block, so a damaged file only loses its tail.
+ * @param cell The cell, with no blocks yet.
+ * @param file The file.
+*/
+static void read_blocks(CellCache *cell, FILE *file) {
+    char line[1024];
+    if (fgets(line, sizeof(line), file) == NULL || strcmp(line, CELL_FORMAT "\n") != 0) {
+        return;
+    }
+    if (fgets(line, sizeof(line), file) == NULL || strncmp(line, cell->description, strlen(cell->description)) != 0
+            || strcmp(line + strlen(cell->description), "\n") != 0) {
+        return;
+    }
+    GameTally block;
+    while (fscanf(file, "%d %d %d %lld %lld\n", &block.trials, &block.shortest, &block.longest, &block.sum,
+                  &block.sum_squares) == 5 && block.trials == CELL_BLOCK) {
+        if (cell_add_block(cell, &block) != 0) {
+            break;
+        }
+    }
+    cell->stored = cell->num_blocks;
+}
+
+/**
+ * @brief Open a cell of the cache, waiting for any other process that has it open, and read its blocks.
+ * @param cell The cell to open.
+ * @param dir The directory of the cache.
+ * @param description The description of the games the cell holds.
+ * @return 0 on success, -1 if the cache cannot be used.
+*/
+int cell_open(CellCache *cell, const char *dir, const char *description) {
+    memset(cell, 0, sizeof(CellCache));
+    cell->lock_fd = -1;
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        printf("Error: could not create cache directory %s\n", dir);
+        return -1;
+    }
+    size_t length = strlen(dir) + 32;
+    cell->path = malloc(length);
+    cell->description = malloc(strlen(description) + 1);
+    char *lock_path = malloc(length);
+    if (cell->path == NULL || cell->description == NULL || lock_path == NULL) {
+        printf("Error: Memory allocation failed.\n");
+        free(lock_path);
+        cell_close(cell);
+        return -1;
+    }
+    strcpy(cell->description, description);
+    unsigned long long key = cell_key(description);
+    snprintf(cell->path, length, "%s/%016llx.cell", dir, key);
+    snprintf(lock_path, length, "%s/%016llx.lock", dir, key);
+
+    // The cell is locked through a file of its own, as its data file is replaced by every store
+    cell->lock_fd = open(lock_path, O_RDWR | O_CREAT, 0666);
+    free(lock_path);
+    if (cell->lock_fd < 0 || flock(cell->lock_fd, LOCK_EX) != 0) {
+        printf("Error: could not lock cache cell %s\n", cell->path);
+        cell_close(cell);
+        return -1;
+    }
+
+    FILE *file = fopen(cell->path, "r");
+    if (file != NULL) {
+        read_blocks(cell, file);
+        fclose(file);
+    }
+    return 0;
+}
+
+/**
+ * @brief Add the tally of the next block of games to a cell.
+ * @param cell The cell.
+ * @param block The tally of the next CELL_BLOCK games.
+ * @return 0 on success, -1 if memory could not be allocated.
+*/
+int cell_add_block(CellCache *cell, const GameTally *block) {
+    if (cell->num_blocks == cell->capacity) {
+        int capacity = cell->capacity > 0 ? 2 * cell->capacity : 16;
+        GameTally *blocks = realloc(cell->blocks, capacity * sizeof(GameTally));
+        if (blocks == NULL) {
+            printf("Error: Memory allocation failed.\n");
+            return -1;
+        }
+        cell->blocks = blocks;
+        cell->capacity = capacity;
+    }
+    cell->blocks[cell->num_blocks++] = *block;
+    return 0;
+}
+
+/**
+ * @brief Write the blocks added to a cell to its file, replacing it atomically.
+ * The blocks are written to a temporary file, which is synced and then renamed over the cell's file, so a reader
+ * sees either the old file or the new one, never a part of it.
+ * @param cell The cell.
+ * @return 0 on success, -1 if the file could not be written.
+*/
+int cell_store(CellCache *cell) {
+    if (cell->num_blocks == cell->stored) {
+        return 0;
+    }
+    size_t length = strlen(cell->path) + 32;
+    char *temp_path = malloc(length);
+    if (temp_path == NULL) {
+        printf("Error: Memory allocation failed.\n");
+        return -1;
+    }
+    snprintf(temp_path, length, "%s.%ld.tmp", cell->path, (long) getpid());
+    FILE *file = fopen(temp_path, "w");
+    if (file == NULL) {
+        printf("Error: could not write cache cell %s\n", temp_path);
+        free(temp_path);
+        return -1;
+    }
+    fprintf(file, "%s\n%s\n", CELL_FORMAT, cell->description);
+    for (int i = 0; i < cell->num_blocks; i++) {
+        const GameTally *block = &cell->blocks[i];
+        fprintf(file, "%d %d %d %lld %lld\n", block->trials, block->shortest, block->longest, block->sum,
+                block->sum_squares);
+    }
+    int failed = fflush(file) != 0 || fsync(fileno(file)) != 0;
+    failed |= fclose(file) != 0;
+    if (failed || rename(temp_path, cell->path) != 0) {
+        printf("Error: could not write cache cell %s\n", cell->path);
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+    free(temp_path);
+    cell->stored = cell->num_blocks;
+    return 0;
+}
+
+/**
+ * @brief Close a cell, letting other processes open it, and free its memory.
+ * @param cell The cell.
+*/
+void cell_close(CellCache *cell) {
+    if (cell->lock_fd >= 0) {
+        close(cell->lock_fd); // closing the file releases the lock
+        cell->lock_fd = -1;
+    }
+    free(cell->path);
+    free(cell->description);
+    free(cell->blocks);
+    cell->path = NULL;
+    cell->description = NULL;
+    cell->blocks = NULL;
+    cell->num_blocks = cell->capacity = cell->stored = 0;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c cell_cache.c -o cell_cache.o
+ * byn links it with statistics.c, which opens one cell for each number of players when given a cache directory.
+ */
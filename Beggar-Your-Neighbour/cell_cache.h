@@ -0,0 +1,72 @@
+/**
+ * @file cell_cache.h
+ * Header file for the on-disk cache of byn results.
+ * Each cell of a byn sweep, one number of players, is kept in a file named after an FNV-1a hash of a description of
+ * everything its games depend on: the rules, the code version, the deck, the number of players, the random number
+ * generator and the seed. The file holds the tallies of consecutive blocks of CELL_BLOCK games starting from game 0,
+ * so a later run asking for more games only plays the ones that are missing, and adds them to the file.
+ * Files are replaced by renaming a complete new file over them, and a process holds a lock on the cell for as long
+ * as it has it open, so processes on the same machine can share a cache directory.
+ * @author Josh
+*/
+
+#ifndef CELL_CACHE_H
+#define CELL_CACHE_H
+
+#include "statistics.h"
+
+#define CELL_BLOCK 100 /**< The number of games in each cached block */
+
+/**
+ * @brief Struct representing an open cell of the cache.
+*/
+typedef struct {
+    char *path; /**< The path of the cell's file. */
+    char *description; /**< The description the cell was opened with. */
+    int lock_fd; /**< The locked file that keeps other processes out of the cell. */
+    GameTally *blocks; /**< The tallies of games 0 to CELL_BLOCK - 1, CELL_BLOCK to 2 * CELL_BLOCK - 1, and so on. */
+    int num_blocks; /**< The number of blocks known. */
+    int capacity; /**< The number of blocks there is room for. */
+    int stored; /**< The number of blocks in the file. */
+} CellCache;
+
+/**
+ * @brief Hash a cell's description into its key.
+ * @param description The description.
+ * @return The 64-bit FNV-1a hash of the description.
+*/
+unsigned long long cell_key(const char *description);
+
+/**
+ * @brief Open a cell of the cache, waiting for any other process that has it open, and read its blocks.
+ * The directory is created if need be. A file written for another description (a hash collision) or for another
+ * version of the file format is ignored, and replaced by the next cell_store().
+ * @param cell The cell to open.
+ * @param dir The directory of the cache.
+ * @param description The description of the games the cell holds.
+ * @return 0 on success, -1 if the cache cannot be used.
+*/
+int cell_open(CellCache *cell, const char *dir, const char *description);
+
+/**
+ * @brief Add the tally of the next block of games to a cell.
+ * @param cell The cell.
+ * @param block The tally of games num_blocks * CELL_BLOCK to (num_blocks + 1) * CELL_BLOCK - 1.
+ * @return 0 on success, -1 if memory could not be allocated.
+*/
+int cell_add_block(CellCache *cell, const GameTally *block);
+
+/**
+ * @brief Write the blocks added to a cell to its file, replacing it atomically.
+ * @param cell The cell.
+ * @return 0 on success, -1 if the file could not be written.
+*/
+int cell_store(CellCache *cell);
+
+/**
+ * @brief Close a cell, letting other processes open it, and free its memory.
+ * @param cell The cell.
+*/
+void cell_close(CellCache *cell);
+
+#endif /* CELL_CACHE_H */
@@ -1,62 +1,227 @@
 /**
- * @file beggar_statistics.h
+ * @file statistics.c
  * @brief This file contains a function that generates statistics on the game of beggar-my-neighbour
- * The statistics function generates the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
+ * The statistics function generates the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour.
+ * The adaptive version keeps playing games until the average is known precisely enough, so the number of games played
+ * follows how much the game lengths vary for each number of players.
+ * Every game is dealt from a deck shuffled by a generator seeded for that game alone, so any run of games can be
+ * played, cached and merged on its own. The games are played by the simulator of beggar_kernel.c picked for the
+ * number of players.
 */
 #include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
 #include "beggar.h"
+#include "beggar_kernel.h"
+#include "statistics.h"
+#include "cell_cache.h"
+
+#define STATS_Z 1.96 /**< Normal quantile for a 95% confidence interval */
+#define STATS_BATCH CELL_BLOCK /**< Smallest number of games played between two checks of the precision */
+#define STATS_SEED 10 /**< Seed of statistics(), the one beggar() uses */
 
 /**
- * @brief A struct containing the statistics for the game of beggar-my-neighbour
- * shortest - The shortest number of moves required to complete the game
- * longest - The longest number of moves required to complete the game
- * average - The average number of moves required to complete the game
+ * @brief The games being played for one number of players.
 */
 typedef struct {
-    int shortest;
-    int longest;
-    float average;
-} GameStats;
+    int Nplayers; /**< The number of players */
+    unsigned long long seed; /**< The seed of the games */
+    gsl_rng *rng; /**< The generator, reseeded for every game */
+    GameKernel kernel; /**< The simulator specialised for Nplayers, or NULL to use beggar_play() */
+    CellCache cell; /**< The cached blocks of games */
+    int cached; /**< 1 if cell is open, 0 otherwise */
+} GameRun;
 
 /**
- * @brief Generates statistics on the game of beggar-my-neighbour
- * The statistics function generates the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
- * @param Nplayers The number of players in the game
- * @param games The number of times the game is played to calculate statistics
- * @return GameStats struct containing the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
+ * @brief Adds the games of one tally to another.
+ * @param into The tally to add to
+ * @param from The tally to add
 */
-GameStats statistics(int Nplayers, int games) {
-    int shortest = INT_MAX;
-    int longest = 0;
-    float total = 0;
+void tally_merge(GameTally *into, const GameTally *from) {
+    if (from->shortest < into->shortest) {
+        into->shortest = from->shortest;
+    }
+    if (from->longest > into->longest) {
+        into->longest = from->longest;
+    }
+    into->trials += from->trials;
+    into->sum += from->sum;
+    into->sum_squares += from->sum_squares;
+}
+
+/**
+ * @brief Works out the seed of one game from the seed of the run, the number of players and the game number.
+ * @param run The games being played
+ * @param game The game number
+ * @return The seed, mixed with the finaliser of splitmix64 so that neighbouring games get unrelated seeds
+*/
+static unsigned long game_seed(const GameRun *run, int game) {
+    unsigned long long z = run->seed * 0x9E3779B97F4A7C15ULL + ((unsigned long long) run->Nplayers << 32) + game;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned long) (z ^ (z >> 31));
+}
 
-    for (int i = 0; i < games; i++) {
+/**
+ * @brief Plays games of beggar-my-neighbour, each on a deck shuffled for that game
+ * @param run The games being played
+ * @param first The number of the first game
+ * @param last The number after that of the last game
+ * @param tally The tally to add the games to
+*/
+static void play_games(GameRun *run, int first, int last, GameTally *tally) {
+    for (int i = first; i < last; i++) {
         // Initialize the deck of cards
         int deck[52];
-        int i, j, k = 0;
+        int k = 0;
 
         //loop through the values 2 to 14 and, for each value, loops through 4 times to add the value to the deck array. This results in an array of size 52 with values from 2 to 14, 4 times each.
-        for (i = 2; i <= 14; i++) {
-            for (j = 0; j < 4; j++) {
-                deck[k] = i;
+        for (int value = 2; value <= 14; value++) {
+            for (int j = 0; j < 4; j++) {
+                deck[k] = value;
                 k++;
             }
         }
-        int moves = beggar(Nplayers, deck, 0);
+        gsl_rng_set(run->rng, game_seed(run, i));
+        gsl_ran_shuffle(run->rng, deck, 52, sizeof(int));
+
+        int moves = run->kernel != NULL ? run->kernel(deck) : beggar_play(run->Nplayers, deck);
+
+        GameTally one = {1, moves, moves, moves, (long long) moves * moves};
+        tally_merge(tally, &one);
+    }
+}
+
+/**
+ * @brief Adds games to a tally, taking whole blocks from the cache where it has them and caching the blocks it plays
+ * A block that is next to be cached is always played whole and cached, even if only its first games are asked for,
+ * so a number of games that is not a multiple of CELL_BLOCK does not stop the cell from growing. Games asked for
+ * from the middle of a block are played again, as a block's tally cannot be split.
+ * @param run The games being played
+ * @param first The number of the first game
+ * @param last The number after that of the last game
+ * @param tally The tally to add the games to
+*/
+static void add_games(GameRun *run, int first, int last, GameTally *tally) {
+    while (first < last) {
+        int block = first / CELL_BLOCK;
+        int end = (block + 1) * CELL_BLOCK;
+        int stop = end < last ? end : last;
+        if (first % CELL_BLOCK != 0) { // the middle of a block: play the games asked for
+            play_games(run, first, stop, tally);
+        } else if (run->cached && block < run->cell.num_blocks && end <= last) {
+            tally_merge(tally, &run->cell.blocks[block]);
+        } else if (run->cached && block == run->cell.num_blocks) {
+            GameTally asked = GAME_TALLY_EMPTY;
+            GameTally games = GAME_TALLY_EMPTY;
+            play_games(run, first, stop, &asked);
+            play_games(run, stop, end, &games);
+            tally_merge(tally, &asked);
+            tally_merge(&games, &asked);
+            cell_add_block(&run->cell, &games);
+        } else {
+            play_games(run, first, stop, tally);
+        }
+        first = stop;
+    }
+    if (run->cached) {
+        cell_store(&run->cell);
+    }
+}
+
+/**
+ * @brief Opens the cache cell of the games being played
+ * @param run The games being played
+ * @param cache_dir The directory of the cache
+*/
+static void open_cell(GameRun *run, const char *cache_dir) {
+    char description[512];
+    int length = snprintf(description, sizeof(description), "rules=%s; version=%d; deck=", BEGGAR_RULES,
+                          BEGGAR_VERSION);
+    for (int value = 2; value <= 14; value++) {
+        for (int j = 0; j < 4; j++) {
+            length += snprintf(description + length, sizeof(description) - length, "%d ", value);
+        }
+    }
+    snprintf(description + length, sizeof(description) - length, "; players=%d; games=0+%d*n; rng=%s; seed=%llu",
+             run->Nplayers, CELL_BLOCK, gsl_rng_name(run->rng), run->seed);
+    run->cached = cell_open(&run->cell, cache_dir, description) == 0;
+}
+
+/**
+ * @brief Generates statistics on the game of beggar-my-neighbour
+ * The statistics function generates the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
+ * @param Nplayers The number of players in the game
+ * @param games The number of times the game is played to calculate statistics
+ * @return GameStats struct containing the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
+*/
+GameStats statistics(int Nplayers, int games) {
+    return statistics_adaptive(Nplayers, 0, games, games, STATS_SEED, NULL);
+}
+
+/**
+ * @brief Generates statistics on the game of beggar-my-neighbour, playing until the average is known to a given precision
+ * After min_trials games, the precision is checked after every batch, which is a tenth of the games played so far
+ * but at least STATS_BATCH, and ends on a whole block of the cache, so the checks get rarer as the interval narrows.
+ * @param Nplayers The number of players in the game
+ * @param precision The relative half width of the 95% confidence interval wanted, or 0 to play max_trials games
+ * @param min_trials The number of games to play before the precision is first checked
+ * @param max_trials The largest number of games to play
+ * @param seed The seed of the games, or a negative number to seed them with the time and cache nothing
+ * @param cache_dir The directory of the cache, or NULL
+ * @return GameStats struct containing the shortest, longest, and average number of moves, the games played and the precision reached
+*/
+GameStats statistics_adaptive(int Nplayers, double precision, int min_trials, int max_trials, int seed,
+                              const char *cache_dir) {
+    GameRun run;
+    run.Nplayers = Nplayers;
+    run.kernel = beggar_kernel(Nplayers);
+    run.seed = seed < 0 ? (unsigned long long) time(NULL) : (unsigned long long) seed;
+    gsl_rng_env_setup();
+    run.rng = gsl_rng_alloc(gsl_rng_default);
+    if (run.rng == NULL) {
+        printf("Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    run.cached = 0;
+    if (cache_dir != NULL && seed >= 0) {
+        open_cell(&run, cache_dir);
+    }
+
+    GameTally tally = GAME_TALLY_EMPTY;
+    double reached = INFINITY;
+    int target = min_trials < max_trials ? min_trials : max_trials;
 
-        if (moves < shortest) {
-            shortest = moves;
+    while (tally.trials < target) {
+        add_games(&run, tally.trials, target, &tally);
+
+        int games = tally.trials;
+        double mean = (double) tally.sum / games;
+        if (games > 1 && mean > 0) {
+            double variance = (tally.sum_squares - (double) tally.sum * mean) / (games - 1);
+            reached = STATS_Z * sqrt(variance / games) / mean;
         }
-        if (moves > longest) {
-            longest = moves;
+        if (precision > 0 && reached <= precision) {
+            break;
         }
-        total += moves;
+        int batch = games / 10 > STATS_BATCH ? games / 10 : STATS_BATCH;
+        int next = (games + batch) / CELL_BLOCK * CELL_BLOCK;
+        target = next > max_trials ? max_trials : next;
+    }
+
+    if (run.cached) {
+        cell_close(&run.cell);
     }
+    gsl_rng_free(run.rng);
 
     GameStats stats;
-    stats.shortest = shortest;///< The shortest number of moves required to complete the game
-    stats.longest = longest; ///< The longest number of moves required to complete the game
-    stats.average = total / games; ///< The average number of moves required to complete the game
+    stats.shortest = tally.shortest;
+    stats.longest = tally.longest;
+    stats.average = tally.trials > 0 ? (double) tally.sum / tally.trials : 0;
+    stats.trials = tally.trials;
+    stats.precision = reached;
 
-    return stats; ///< GameStats struct containing the shortest, longest, and average number of moves required to complete the game of beggar-my-neighbour
-}
\ No newline at end of file
+    return stats;
+}
@@ -1,14 +1,42 @@
-#ifndef BEGGAR_H
-#define BEGGAR_H
+#ifndef STATISTICS_H
+#define STATISTICS_H
 
 #include <limits.h>
 
+/**
+ * A struct containing the statistics for a number of games of beggar.
+ */
 typedef struct {
-    int shortest;
-    int longest;
-    float average;
+    int shortest; /**< The shortest number of moves required to complete the game */
+    int longest; /**< The longest number of moves required to complete the game */
+    float average; /**< The average number of moves required to complete the game */
+    int trials; /**< The number of games played */
+    float precision; /**< Half the width of the 95% confidence interval of the average, as a fraction of the average */
 } GameStats;
 
+/**
+ * A running tally of game lengths. The sums are exact, so tallies of separate runs of games can be merged in any
+ * order and give the same statistics as one run.
+ */
+typedef struct {
+    int trials; /**< The number of games tallied */
+    int shortest; /**< The shortest game, INT_MAX if there are none */
+    int longest; /**< The longest game, 0 if there are none */
+    long long sum; /**< The sum of the numbers of moves */
+    long long sum_squares; /**< The sum of the squares of the numbers of moves */
+} GameTally;
+
+/** An empty tally */
+#define GAME_TALLY_EMPTY {0, INT_MAX, 0, 0, 0}
+
+/**
+ * Adds the games of one tally to another.
+ *
+ * @param into the tally to add to
+ * @param from the tally to add
+ */
+void tally_merge(GameTally *into, const GameTally *from);
+
 /**
  * Calculates the shortest, longest, and average number of moves in a game of beggar
  * with the given number of players and number of games.
@@ -19,4 +47,22 @@ typedef struct {
  */
 GameStats statistics(int Nplayers, int games);
 
-#endif /* BEGGAR_H */
+/**
+ * Calculates the same statistics as statistics(), playing games in batches until the average is known to the given
+ * precision: until half the width of its 95% confidence interval is at most precision times the average.
+ * Game number i is dealt from a deck shuffled by a generator seeded from seed, Nplayers and i alone, so the results
+ * for a number of games never depend on what was played before. With a cache directory, the games already played
+ * for the same seed are read from it instead of being played again, and the new ones are added to it.
+ *
+ * @param Nplayers the number of players in the game
+ * @param precision the relative precision wanted, e.g. 0.01 for the average to within 1%; 0 plays max_trials games
+ * @param min_trials the number of games to play before the precision is first checked
+ * @param max_trials the number of games after which to stop even if the precision has not been reached
+ * @param seed the seed of the games; if negative, the time is used and nothing is cached
+ * @param cache_dir the directory of the cache (see cell_cache.h), or NULL for none
+ * @return a GameStats struct whose trials and precision say how many games were played and the precision reached
+ */
+GameStats statistics_adaptive(int Nplayers, double precision, int min_trials, int max_trials, int seed,
+                              const char *cache_dir);
+
+#endif /* STATISTICS_H */
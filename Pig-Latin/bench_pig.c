@@ -0,0 +1,560 @@
+/**
+* @file bench_pig.c
+* @brief This program measures how fast the Pig Latin translators are, in words and bytes per second.
+* It generates a synthetic corpus whose words follow a Zipf distribution, like the words of real text: a vocabulary
+* of made-up words (including y-initial words and words without vowels), ranked so that word k is drawn with
+* probability proportional to 1 / k^s, separated by spaces, punctuation and line breaks. Every translator then
+* translates the whole corpus: pig() word by word, pig_into, pig_batch_packed, the line path of the interactive
+* program (pig_line), pig_text with and without a cache, and the stream and threaded translators.
+* Each benchmark is run for enough iterations to take at least the minimum time, and that measurement is repeated;
+* the median run is reported.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#define _GNU_SOURCE /* fmemopen, sched_setaffinity */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "pig.h"
+#include "pig_batch.h"
+#include "pig_cache.h"
+#include "pig_ctype.h"
+#include "pig_simd.h"
+#include "pig_stream.h"
+#include "pig_utf8.h"
+
+/** Settings of the generated corpus. */
+typedef struct {
+    size_t bytes;       /**< Approximate size of the corpus. */
+    size_t vocabulary;  /**< Number of distinct words. */
+    double exponent;    /**< Zipf exponent s. */
+    double accents;     /**< Fraction of vocabulary vowels written with an accent (UTF-8). */
+    uint64_t seed;      /**< Seed of the generator. */
+} CorpusSpec;
+
+/** The corpus and the forms of it the benchmarks work on. */
+typedef struct {
+    char *text;             /**< The corpus. */
+    size_t len;             /**< Its length in bytes. */
+    size_t words;           /**< Number of words in it. */
+    char **word;            /**< The words as NUL-terminated strings, for pig(). */
+    char *word_bytes;       /**< Storage of the NUL-terminated words. */
+    size_t *offsets;        /**< words + 1 offsets of the words packed one after another in packed. */
+    char *packed;           /**< The words without separators, for pig_batch_packed. */
+    char *lines;            /**< The corpus with punctuation turned into spaces, which the line path accepts. */
+    size_t *line_start;     /**< line_count + 1 offsets of the lines in lines. */
+    size_t line_count;      /**< Number of lines. */
+    char *out;              /**< Output buffer of PIG_TEXT_MAX(len) bytes. */
+    PigCache cache;         /**< Cache for the cached benchmarks. */
+    int threads;            /**< Threads of the threaded benchmark. */
+    FILE *null;             /**< /dev/null, where the stream benchmarks write. */
+} Corpus;
+
+/**
+* @brief A benchmark: one iteration translates the whole corpus once.
+*/
+typedef struct {
+    const char *name;           /**< Name printed in the report. */
+    size_t (*body)(Corpus *c);  /**< One iteration; returns a number that depends on the output. */
+} BenchCase;
+
+static volatile size_t sink; /**< Keeps results alive so the compiler cannot drop the work. */
+
+/**
+* @brief Returns the next number of a splitmix64 generator.
+* @param state The state of the generator.
+* @return A 64-bit pseudo-random number.
+*/
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+* @brief Returns a pseudo-random number below n.
+* @param state The state of the generator.
+* @param n The bound, at least 1.
+* @return A number from 0 to n - 1.
+*/
+
+static size_t below(uint64_t *state, size_t n) {
+    return (size_t) (next_random(state) % n);
+}
+
+/**
+* @brief Returns a pseudo-random double in [0, 1).
+* @param state The state of the generator.
+* @return The number.
+*/
+
+static double uniform(uint64_t *state) {
+    return (double) (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+* @brief Makes up a word of one to four syllables, writing it to out.
+* About one word in twelve starts with y and one in forty has no vowel at all ("rhythm", "nth").
+* @param state The state of the generator.
+* @param accents Fraction of vowels written with an accent.
+* @param out Receives the word; it must have room for 64 bytes.
+* @return The length of the word in bytes.
+*/
+
+static size_t make_word(uint64_t *state, double accents, char *out) {
+    static const char *const onsets[] = {
+        "", "", "", "b", "c", "d", "f", "g", "h", "j", "k", "l", "m", "n", "p", "qu", "r", "s", "t", "v", "w",
+        "z", "bl", "br", "ch", "cl", "cr", "dr", "fl", "fr", "gl", "gr", "pl", "pr", "sc", "sh", "sl", "sm", "sn",
+        "sp", "st", "str", "th", "thr", "tr", "wh", "wr",
+    };
+    static const char *const nuclei[] = { "a", "e", "i", "o", "u", "ea", "ee", "oo", "ou", "ai", "y", "ie" };
+    static const char *const codas[] = { "", "", "", "n", "r", "s", "t", "d", "l", "ng", "st", "ck", "nd", "rm", "th" };
+    static const char *const voiceless[] = { "rhythm", "nth", "crwth", "tsk", "shh", "psst", "hmm", "brr" };
+    static const char *const accented[] = { "\xC3\xA9", "\xC3\xA0", "\xC3\xAF", "\xC3\xB4", "\xC3\xBC" }; // é à ï ô ü
+    size_t n = 0;
+    if (below(state, 40) == 0) {
+        const char *w = voiceless[below(state, sizeof(voiceless) / sizeof(voiceless[0]))];
+        n = strlen(w);
+        memcpy(out, w, n);
+        return n;
+    }
+    if (below(state, 12) == 0) {
+        out[n++] = 'y';
+    }
+    size_t syllables = 1 + below(state, 3) + (below(state, 4) == 0);
+    for (size_t k = 0; k < syllables; k++) {
+        const char *onset = onsets[below(state, sizeof(onsets) / sizeof(onsets[0]))];
+        const char *nucleus = nuclei[below(state, sizeof(nuclei) / sizeof(nuclei[0]))];
+        memcpy(out + n, onset, strlen(onset));
+        n += strlen(onset);
+        if (accents > 0 && strchr("aeiou", nucleus[0]) != NULL && uniform(state) < accents) {
+            const char *a = accented[below(state, sizeof(accented) / sizeof(accented[0]))];
+            memcpy(out + n, a, 2);
+            n += 2;
+        } else {
+            memcpy(out + n, nucleus, strlen(nucleus));
+            n += strlen(nucleus);
+        }
+    }
+    const char *coda = codas[below(state, sizeof(codas) / sizeof(codas[0]))];
+    memcpy(out + n, coda, strlen(coda));
+    return n + strlen(coda);
+}
+
+/**
+* @brief Allocates memory or exits.
+* @param size The number of bytes.
+* @return The memory.
+*/
+
+static void *checked_malloc(size_t size) {
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/**
+* @brief Generates the corpus: Zipf-distributed words from a made-up vocabulary.
+* A sentence starts with a capital; words are followed by a space, a comma or a full stop, and lines are broken
+* at about 70 bytes.
+* @param spec The settings.
+* @param text Receives the corpus (malloc'd).
+* @return The length of the corpus.
+*/
+
+static size_t generate(const CorpusSpec *spec, char **text) {
+    uint64_t state = spec->seed;
+    size_t v = spec->vocabulary > 0 ? spec->vocabulary : 1;
+    char *vocab = checked_malloc(v * 64);
+    unsigned char *vocab_len = checked_malloc(v);
+    double *cdf = checked_malloc(v * sizeof(double));
+    double total = 0;
+    for (size_t k = 0; k < v; k++) {
+        vocab_len[k] = (unsigned char) make_word(&state, spec->accents, vocab + k * 64);
+        total += 1.0 / pow((double) (k + 1), spec->exponent);
+        cdf[k] = total;
+    }
+
+    char *t = checked_malloc(spec->bytes + 128);
+    size_t n = 0, line = 0;
+    int capital = 1;
+    while (n < spec->bytes) {
+        double u = uniform(&state) * total;
+        size_t lo = 0, hi = v - 1;
+        while (lo < hi) { // the first rank whose cumulative weight exceeds u
+            size_t mid = lo + (hi - lo) / 2;
+            if (cdf[mid] > u) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        memcpy(t + n, vocab + lo * 64, vocab_len[lo]);
+        if (capital && pig_is(t[n], PIG_LETTER)) {
+            t[n] &= ~0x20;
+        }
+        n += vocab_len[lo];
+        line += vocab_len[lo];
+        size_t r = below(&state, 100);
+        capital = r < 6;
+        if (r < 6) {
+            t[n++] = '.';
+        } else if (r < 14) {
+            t[n++] = ',';
+        }
+        if (line > 70) {
+            t[n++] = '\n';
+            line = 0;
+        } else {
+            t[n++] = ' ';
+            line++;
+        }
+    }
+    free(vocab);
+    free(vocab_len);
+    free(cdf);
+    *text = t;
+    return n;
+}
+
+/**
+* @brief Builds the forms of the corpus the benchmarks need.
+* @param c The corpus, whose text and len are set.
+*/
+
+static void prepare(Corpus *c) {
+    size_t count = 0;
+    for (size_t i = pig_utf8_span_nonletters(c->text, c->len); i < c->len; count++) {
+        i += pig_utf8_span_letters(c->text + i, c->len - i);
+        i += pig_utf8_span_nonletters(c->text + i, c->len - i);
+    }
+    c->words = count;
+    c->word = checked_malloc(count * sizeof(char *));
+    c->word_bytes = checked_malloc(c->len + count);
+    c->offsets = checked_malloc((count + 1) * sizeof(size_t));
+    c->packed = checked_malloc(c->len);
+    size_t w = 0, o = 0, p = 0;
+    for (size_t i = pig_utf8_span_nonletters(c->text, c->len); i < c->len; w++) {
+        size_t end = i + pig_utf8_span_letters(c->text + i, c->len - i);
+        c->word[w] = c->word_bytes + o;
+        memcpy(c->word_bytes + o, c->text + i, end - i);
+        o += end - i;
+        c->word_bytes[o++] = '\0';
+        c->offsets[w] = p;
+        memcpy(c->packed + p, c->text + i, end - i);
+        p += end - i;
+        i = end + pig_utf8_span_nonletters(c->text + end, c->len - end);
+    }
+    c->offsets[count] = p;
+
+    c->lines = checked_malloc(c->len);
+    c->line_count = 0;
+    for (size_t i = 0; i < c->len; i++) {
+        c->lines[i] = c->text[i] == '.' || c->text[i] == ',' ? ' ' : c->text[i];
+        c->line_count += c->text[i] == '\n';
+    }
+    c->line_start = checked_malloc((c->line_count + 2) * sizeof(size_t));
+    size_t l = 0;
+    c->line_start[l++] = 0;
+    for (size_t i = 0; i < c->len; i++) {
+        if (c->text[i] == '\n') {
+            c->line_start[l++] = i + 1;
+        }
+    }
+    if (c->line_start[l - 1] < c->len) { // a last line without a newline
+        c->line_start[l++] = c->len;
+    }
+    c->line_count = l - 1;
+    c->out = checked_malloc(PIG_TEXT_MAX(c->len) > PIG_LINE_MAX(c->len) ? PIG_TEXT_MAX(c->len) : PIG_LINE_MAX(c->len));
+}
+
+static size_t body_pig(Corpus *c) {
+    size_t n = 0;
+    for (size_t i = 0; i < c->words; i++) {
+        char *t = pig(c->word[i]);
+        n += (unsigned char) t[0];
+        free(t);
+    }
+    return n;
+}
+
+static size_t body_pig_into(Corpus *c) {
+    char t[64];
+    size_t n = 0;
+    for (size_t i = 0; i < c->words; i++) {
+        n += pig_into(c->packed + c->offsets[i], c->offsets[i + 1] - c->offsets[i], t, sizeof(t));
+        n += (unsigned char) t[0];
+    }
+    return n;
+}
+
+static size_t body_batch(Corpus *c) {
+    PigBatch batch;
+    if (pig_batch_packed(c->packed, c->offsets, c->words, &batch) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    size_t n = batch.offsets[batch.count];
+    pig_batch_free(&batch);
+    return n;
+}
+
+static size_t body_line(Corpus *c) {
+    size_t n = 0;
+    for (size_t l = 0; l < c->line_count; l++) {
+        long k = pig_line(NULL, c->lines + c->line_start[l], c->line_start[l + 1] - c->line_start[l], c->out);
+        n += k > 0 ? (size_t) k : 0;
+    }
+    return n;
+}
+
+static size_t body_line_cached(Corpus *c) {
+    size_t n = 0;
+    for (size_t l = 0; l < c->line_count; l++) {
+        long k = pig_line(&c->cache, c->lines + c->line_start[l], c->line_start[l + 1] - c->line_start[l], c->out);
+        n += k > 0 ? (size_t) k : 0;
+    }
+    return n;
+}
+
+static size_t body_text(Corpus *c) {
+    size_t used;
+    return pig_text(c->text, c->len, c->out, PIG_TEXT_MAX(c->len), &used);
+}
+
+static size_t body_text_cached(Corpus *c) {
+    size_t used;
+    return pig_text_cached(&c->cache, c->text, c->len, c->out, PIG_TEXT_MAX(c->len), &used);
+}
+
+static size_t body_stream(Corpus *c) {
+    FILE *in = fmemopen(c->text, c->len, "r");
+    if (in == NULL || pig_translate_stream(in, c->null, 1 << 16, NULL) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    fclose(in);
+    return c->len;
+}
+
+static size_t body_parallel(Corpus *c) {
+    FILE *in = fmemopen(c->text, c->len, "r");
+    if (in == NULL || pig_translate_stream_parallel(in, c->null, 1 << 20, c->threads, NULL) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    fclose(in);
+    return c->len;
+}
+
+static const BenchCase cases[] = {
+    {"pig", body_pig},
+    {"pig_into", body_pig_into},
+    {"pig_batch_packed", body_batch},
+    {"pig_line", body_line},
+    {"pig_line/cache", body_line_cached},
+    {"pig_text", body_text},
+    {"pig_text/cache", body_text_cached},
+    {"stream/64K", body_stream},
+    {"stream_parallel/1M", body_parallel},
+};
+
+/**
+* @brief Returns the time of a monotonic clock in seconds.
+* @return The time in seconds.
+*/
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+* @brief Compares two doubles, for qsort.
+* @param a Pointer to the first double.
+* @param b Pointer to the second double.
+* @return -1, 0 or 1.
+*/
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+* @brief Runs one benchmark case and prints its report line.
+* @param bc The benchmark.
+* @param c The corpus.
+* @param repetitions Number of measured runs; the median is reported.
+* @param min_time Minimum duration of one run in seconds.
+*/
+
+static void run_case(const BenchCase *bc, Corpus *c, int repetitions, double min_time) {
+    double *runs = checked_malloc(repetitions * sizeof(double));
+    long iterations = 1;
+    for (;;) { // double the iterations until one run takes at least min_time
+        double started = now_seconds();
+        for (long i = 0; i < iterations; i++) {
+            sink += bc->body(c);
+        }
+        if (now_seconds() - started >= min_time || iterations >= (1L << 20)) {
+            break;
+        }
+        iterations *= 2;
+    }
+    for (int r = 0; r < repetitions; r++) {
+        double started = now_seconds();
+        for (long i = 0; i < iterations; i++) {
+            sink += bc->body(c);
+        }
+        runs[r] = (now_seconds() - started) / iterations;
+    }
+    qsort(runs, repetitions, sizeof(double), cmp_double);
+    double median = runs[repetitions / 2];
+    double spread = runs[repetitions - 1] - runs[0];
+    printf("%-22s %14.0f %10.1f %10.2f %10.1f%% %10ld\n", bc->name, c->words / median, c->len / median / 1e6,
+           median * 1e9 / c->words, 100.0 * spread / median, iterations);
+    free(runs);
+}
+
+/**
+* @brief Pins the process to one CPU, where the platform supports it.
+* @param cpu The CPU to run on.
+*/
+
+static void pin_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_setaffinity");
+    }
+#else
+    (void) cpu;
+    fprintf(stderr, "CPU pinning is not supported on this platform\n");
+#endif
+}
+
+/**
+* @brief Main function: generates the corpus and runs the benchmarks.
+* @param argc The number of command line arguments
+* @param argv An array of strings containing the command line arguments
+* @return int The exit status of the program.
+*/
+
+int main(int argc, char *argv[]) {
+    CorpusSpec spec = { 16 << 20, 50000, 1.0, 0.0, 12345 };
+    int repetitions = 5;
+    double min_time = 0.2;
+    const char *filter = NULL;
+    const char *save = NULL;
+    Corpus c;
+    memset(&c, 0, sizeof(c));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            spec.bytes = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            spec.vocabulary = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            spec.exponent = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            spec.accents = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            spec.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            pin_cpu(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            c.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            save = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-n corpus_bytes] [-v vocabulary] [-s zipf_exponent] [-a accent_fraction] [-S seed]\n"
+                    "       [-r repetitions] [-t min_seconds_per_run] [-c cpu] [-j threads] [-f name_filter] [-o corpus_file]\n", argv[0]);
+            fprintf(stderr, "  -o writes the generated corpus to corpus_file and exits, for timing the programs on it\n");
+            return 1;
+        }
+    }
+    if (repetitions < 1) {
+        repetitions = 1;
+    }
+
+    c.len = generate(&spec, &c.text);
+    if (save != NULL) {
+        FILE *fp = fopen(save, "wb");
+        if (fp == NULL || fwrite(c.text, 1, c.len, fp) != c.len || fclose(fp) != 0) {
+            perror(save);
+            return 1;
+        }
+        free(c.text);
+        return 0;
+    }
+    prepare(&c);
+    if (pig_cache_init(&c.cache, 8192) != 0) {
+        return 1;
+    }
+    c.null = fopen("/dev/null", "w");
+    if (c.null == NULL) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    printf("corpus: %zu bytes, %zu words, %zu lines, vocabulary %zu, s = %.2f, accents %.2f; scans: %s\n",
+           c.len, c.words, c.line_count, spec.vocabulary, spec.exponent, spec.accents, pig_simd_isa());
+    printf("%-22s %14s %10s %10s %11s %10s\n", "Benchmark", "words/s", "MB/s", "ns/word", "spread", "iterations");
+    int cached = 0;
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        if (filter != NULL && strstr(cases[k].name, filter) == NULL) {
+            continue;
+        }
+        run_case(&cases[k], &c, repetitions, min_time);
+        cached |= strstr(cases[k].name, "cache") != NULL;
+        fflush(stdout);
+    }
+    if (cached) {
+        pig_cache_print_stats(&c.cache, stdout);
+    }
+
+    fclose(c.null);
+    pig_cache_free(&c.cache);
+    free(c.text);
+    free(c.word);
+    free(c.word_bytes);
+    free(c.offsets);
+    free(c.packed);
+    free(c.lines);
+    free(c.line_start);
+    free(c.out);
+    return 0;
+}
+
+/* Instructions for running the program:
+ * To compile and run the benchmarks, run the following command in the terminal:
+ * make bench
+ *
+ * or, to pass options:
+ * make bench_pig
+ * ./bench_pig -n 67108864 -s 1.1 -r 9 -c 0
+ * ./bench_pig -a 0.3 -f pig_text
+ * ./bench_pig -o corpus.txt && time ./piglatin corpus.txt > /dev/null
+ *
+ * words/s and MB/s are for the words and bytes of the corpus; spread is (slowest - fastest) / median.
+ */
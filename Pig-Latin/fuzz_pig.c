@@ -0,0 +1,524 @@
+/**
+* @file fuzz_pig.c
+* @brief This program checks the faster Pig Latin translators against pig() on random input.
+* pig() is the reference: after checking it on a table of known translations (y-initial words, words without
+* vowels such as "rhythm", capitals, accented words), the program makes up random words and checks that pig_into
+* (with buffers of every size, down to truncation), pig_emit, the cache and the batch translator give the same
+* translation. Random texts built from the words and random separators (punctuation, digits, other UTF-8
+* characters and invalid bytes) are translated with pig_text, the stream translator fed in random pieces, the
+* threaded translator and the line path, and compared with the words translated one by one by pig().
+* The reverse translator is checked the other way round: whatever English it gives for a translation, without a
+* dictionary, must translate back to the same Pig Latin, word by word and for whole texts, for the words whose
+* capitals pig() keeps.
+* The first mismatches are printed; the exit status is 1 if there were any.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#define _GNU_SOURCE /* fmemopen, open_memstream */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pig.h"
+#include "pig_batch.h"
+#include "pig_cache.h"
+#include "pig_ctype.h"
+#include "pig_reverse.h"
+#include "pig_utf8.h"
+#include "pig_stream.h"
+
+/** The longest random word in bytes. */
+#define WORD_MAX 96
+/** The number of words in a random text. */
+#define TEXT_WORDS 200
+/** The number of words in a random batch. */
+#define BATCH_WORDS 64
+
+/** Known translations that pig() itself must give. */
+static const char *const known[][2] = {
+    {"happy", "appyhay"}, {"duck", "uckday"}, {"glove", "oveglay"}, {"evil", "evilway"}, {"eight", "eightway"},
+    {"yowler", "owleryay"}, {"crystal", "ystalcray"}, {"yellow", "ellowyay"}, {"y", "yay"}, {"my", "ymay"},
+    {"rhythm", "ythmrhay"}, {"nth", "nthay"}, {"b", "bay"}, {"a", "away"}, {"", "way"}, {"Happy", "Appyhay"},
+    {"HAPPY", "APPYHAY"}, {"Yellow", "Ellowyay"}, {"NTH", "NTHAY"}, {"Nth", "Nthay"}, {"I", "Iway"},
+    {"caf\xC3\xA9", "af\xC3\xA9" "cay"}, {"\xC3\x91" "and\xC3\xBA", "And\xC3\xBA\xC3\xB1" "ay"},
+    {"\xC3\x89" "COLE", "\xC3\x89" "COLEWAY"}, {"\xC3\xA9lan", "\xC3\xA9lanway"},
+};
+
+/** Known decodings without a dictionary, where the first English word that fits is the right one. */
+static const char *const known_decoded[][2] = {
+    {"appyhay", "happy"}, {"Appyhay", "Happy"}, {"APPYHAY", "HAPPY"}, {"evilway", "evil"},
+    {"af\xC3\xA9" "cay", "caf\xC3\xA9"}, {"And\xC3\xBA\xC3\xB1" "ay", "\xC3\x91" "and\xC3\xBA"},
+    {"\xC3\x89" "COLEWAY", "\xC3\x89" "COLE"}, {"\xC3\xA9lanway", "\xC3\xA9lan"},
+    {"\xC3\xBC" "berway", "\xC3\xBC" "ber"}, {"\xC3\x9C" "BERWAY", "\xC3\x9C" "BER"},
+};
+
+/** Letters the random words are made of, weighted by repetition: vowels, y, capitals and accented letters. */
+static const char *const letters[] = {
+    "a", "e", "i", "o", "u", "y", "y", "Y", "b", "c", "d", "f", "g", "h", "k", "l", "m", "n", "p", "r", "s", "t",
+    "w", "z", "q", "x", "v", "j", "A", "E", "B", "T", "S", "R", "H", "M",
+    "\xC3\xA9", "\xC3\xA0", "\xC3\xBC", "\xC3\xB1", "\xC3\xA7", "\xC3\x89", "\xC3\x91", "\xC3\x9C", "\xC3\x9F",
+    "\xC3\xBF", "\xC5\xB8", "\xC5\x93", "\xC5\x81", "\xC5\x82", "\xC4\xB1", "\xC4\xB0", "\xC5\xBD",
+};
+
+/** Separators between the words of random texts; none of them holds a letter. */
+static const char *const separators[] = {
+    " ", " ", " ", "  ", "\n", ", ", ". ", "!", "?\n", "\t", "-", "'", "42", " 7 ", "\xE2\x80\x94", "\xE4\xB8\xAD",
+    "\xF0\x9F\x98\x80", "\xC2\xA0", "\xC3\x97", "\xC2\xAB", "\x80", "\xFF", "\xC3", "\xE4\xB8", " \xC0\xAF ",
+};
+
+/** Totals of a fuzzing run. */
+typedef struct {
+    long checks;    /**< Comparisons made. */
+    long failures;  /**< Comparisons that failed. */
+    long shown;     /**< Failures printed so far. */
+    long show_max;  /**< Failures to print at most. */
+} Tally;
+
+/**
+* @brief Returns the next number of a splitmix64 generator.
+* @param state The state of the generator.
+* @return A 64-bit pseudo-random number.
+*/
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+* @brief Returns a pseudo-random number below n.
+* @param state The state of the generator.
+* @param n The bound, at least 1.
+* @return A number from 0 to n - 1.
+*/
+
+static size_t below(uint64_t *state, size_t n) {
+    return (size_t) (next_random(state) % n);
+}
+
+/**
+* @brief Prints bytes with everything but printable ASCII escaped.
+* @param s The bytes.
+* @param len The number of bytes.
+*/
+
+static void print_escaped(const char *s, size_t len) {
+    putchar('"');
+    for (size_t i = 0; i < len && i < 200; i++) {
+        unsigned char c = (unsigned char) s[i];
+        if (c >= 0x20 && c < 0x7F && c != '"' && c != '\\') {
+            putchar(c);
+        } else {
+            printf("\\x%02X", c);
+        }
+    }
+    printf(len > 200 ? "\"..." : "\"");
+}
+
+/**
+* @brief Counts a comparison of a translation with the expected one, printing it if it fails.
+* @param t The totals.
+* @param what The translator that was checked.
+* @param input What was translated.
+* @param input_len Its length.
+* @param expected The translation pig() gives.
+* @param expected_len Its length.
+* @param got The translation that was checked.
+* @param got_len Its length.
+*/
+
+static void check(Tally *t, const char *what, const char *input, size_t input_len, const char *expected,
+                  size_t expected_len, const char *got, size_t got_len) {
+    t->checks++;
+    if (expected_len == got_len && memcmp(expected, got, got_len) == 0) {
+        return;
+    }
+    t->failures++;
+    if (t->shown++ < t->show_max) {
+        printf("%s: ", what);
+        print_escaped(input, input_len);
+        printf("\n  expected ");
+        print_escaped(expected, expected_len);
+        printf("\n  got      ");
+        print_escaped(got, got_len);
+        printf("\n");
+    }
+}
+
+/**
+* @brief Makes up a random word, favouring the edge cases: y-initial words, words without vowels, words in capitals
+* and long words (past the vector, cache and block sizes).
+* @param state The state of the generator.
+* @param out Receives the NUL-terminated word; it must have room for WORD_MAX + 1 bytes.
+* @return The length of the word in bytes, at least 1.
+*/
+
+static size_t random_word(uint64_t *state, char *out) {
+    static const size_t lengths[] = { 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 15, 16, 17, 20, 27, 28, 33, 64, 70 };
+    size_t target = lengths[below(state, sizeof(lengths) / sizeof(lengths[0]))];
+    int kind = (int) below(state, 8);
+    size_t n = 0;
+    if (kind == 0) {
+        out[n++] = below(state, 2) ? 'y' : 'Y';
+    }
+    while (n < target) {
+        const char *l;
+        if (kind == 1) { // no vowels: "rhythm", "nth"
+            static const char *const consonants[] = { "r", "h", "y", "t", "m", "n", "s", "R", "H", "T", "\xC3\xB1" };
+            l = consonants[below(state, sizeof(consonants) / sizeof(consonants[0]))];
+        } else if (kind == 2) { // capitals only
+            static const char *const capitals[] = { "A", "B", "E", "R", "Y", "T", "\xC3\x89", "\xC3\x91", "\xC5\xB8", "\xC4\xB0" };
+            l = capitals[below(state, sizeof(capitals) / sizeof(capitals[0]))];
+        } else {
+            l = letters[below(state, sizeof(letters) / sizeof(letters[0]))];
+        }
+        size_t k = strlen(l);
+        if (n + k > WORD_MAX) {
+            break;
+        }
+        memcpy(out + n, l, k);
+        n += k;
+    }
+    if (kind == 3 && n > 0 && out[0] >= 'a' && out[0] <= 'z') {
+        out[0] &= ~0x20; // capitalised
+    }
+    out[n] = '\0';
+    return n;
+}
+
+/**
+* @brief Checks whether the capitals of a word come back from the reverse translator: pig() keeps them only for
+* words in lower case, capitalised or in capitals, and cannot give a capital to the letters without one (ß, İ, ı).
+* Two capitals are left out too: "WE" gives "EWAY", which is read back as "E" + "WAY".
+* @param word The NUL-terminated word.
+* @param len Its length.
+* @return 1 if the word should decode to a word with the same translation, 0 otherwise.
+*/
+
+static int keeps_case(const char *word, size_t len) {
+    if (strstr(word, "\xC3\x9F") != NULL || strstr(word, "\xC4\xB0") != NULL || strstr(word, "\xC4\xB1") != NULL) {
+        return 0;
+    }
+    size_t letters = 0, capitals = 0, k;
+    int first = 0;
+    for (size_t i = 0; i < len; i += k) {
+        int upper = pig_utf8_char(word + i, len - i, &k) & PIG_UPPER;
+        first = i == 0 ? upper : first;
+        letters++;
+        capitals += upper != 0;
+    }
+    return capitals == 0 || (capitals == letters && letters > 2) || (capitals == 1 && first);
+}
+
+/**
+* @brief Checks the word translators against pig() on one word.
+* @param t The totals.
+* @param cache A cache that fills up as words are checked.
+* @param state The state of the generator.
+* @param word The NUL-terminated word.
+* @param len Its length.
+*/
+
+static void check_word(Tally *t, PigCache *cache, uint64_t *state, char *word, size_t len) {
+    char *expected = pig(word);
+    size_t n = strlen(expected);
+    char out[WORD_MAX + 8];
+
+    size_t full = pig_into(word, len, out, sizeof(out));
+    check(t, "pig_into", word, len, expected, n, out, full == strlen(out) ? full : (size_t) -1);
+
+    size_t cap = below(state, n + 2); // 0 to n + 1: truncated, exact and with room to spare
+    memset(out, '#', sizeof(out));
+    size_t whole = pig_into(word, len, out, cap);
+    size_t kept = cap == 0 ? 0 : (n < cap ? n : cap - 1);
+    int ok = whole == n && (cap == 0 ? out[0] == '#' : out[kept] == '\0');
+    check(t, "pig_into (truncated)", word, len, expected, kept, out, ok ? kept : (size_t) -1);
+
+    check(t, "pig_emit", word, len, expected, n, out, pig_emit(word, len, pig_cluster(word, len), out));
+    check(t, "pig_cache_translate", word, len, expected, n, out, pig_cache_translate(cache, word, len, out));
+    check(t, "pig_cache_translate (again)", word, len, expected, n, out, pig_cache_translate(cache, word, len, out));
+
+    int kind;
+    long m = pig_decode_word(NULL, expected, n, out, &kind);
+    char *again = NULL;
+    if (m >= 0 && kind != PIG_NOT_PIG) {
+        out[m] = '\0';
+        again = pig(out);
+    }
+    int same_case = keeps_case(word, len);
+    if (!same_case && again != NULL) { // the capitals were partly lost: only the letters have to come back
+        pig_utf8_lower(expected, n, expected);
+        pig_utf8_lower(again, strlen(again), again);
+    }
+    check(t, same_case ? "pig_decode_word (round trip)" : "pig_decode_word (round trip, any case)", word, len,
+          expected, n, again != NULL ? again : "", again != NULL ? strlen(again) : (size_t) -1);
+    free(again);
+    free(expected);
+}
+
+/**
+* @brief Checks the batch translators against pig() on a batch of random words.
+* @param t The totals.
+* @param state The state of the generator.
+*/
+
+static void check_batch(Tally *t, uint64_t *state) {
+    static char words[BATCH_WORDS][WORD_MAX + 1];
+    const char *list[BATCH_WORDS];
+    char packed[BATCH_WORDS * WORD_MAX];
+    size_t offsets[BATCH_WORDS + 1];
+    size_t count = below(state, BATCH_WORDS + 1), p = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = below(state, 10) == 0 ? 0 : random_word(state, words[i]);
+        words[i][len] = '\0';
+        list[i] = words[i];
+        offsets[i] = p;
+        memcpy(packed + p, words[i], len);
+        p += len;
+    }
+    offsets[count] = p;
+    PigBatch batch, batch_packed;
+    if (pig_batch(list, count, &batch) != 0 || pig_batch_packed(packed, offsets, count, &batch_packed) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        char *expected = pig(words[i]);
+        const char *a = pig_batch_word(&batch, i), *b = pig_batch_word(&batch_packed, i);
+        check(t, "pig_batch", words[i], strlen(words[i]), expected, strlen(expected), a, strlen(a));
+        check(t, "pig_batch_packed", words[i], strlen(words[i]), expected, strlen(expected), b, strlen(b));
+        free(expected);
+    }
+    pig_batch_free(&batch);
+    pig_batch_free(&batch_packed);
+}
+
+/**
+* @brief Appends bytes to a growing buffer.
+* @param buf The buffer.
+* @param len Its length.
+* @param s The bytes.
+* @param n The number of bytes.
+*/
+
+static void append(char *buf, size_t *len, const char *s, size_t n) {
+    memcpy(buf + *len, s, n);
+    *len += n;
+}
+
+/**
+* @brief Translates a text through a stream fed in random pieces.
+* @param state The state of the generator.
+* @param text The text.
+* @param len Its length.
+* @param out Receives the translation (malloc'd by open_memstream).
+* @param buffer_size The output buffer of the stream.
+* @return The length of the translation.
+*/
+
+static size_t stream_pieces(uint64_t *state, const char *text, size_t len, char **out, size_t buffer_size) {
+    size_t out_len = 0;
+    FILE *fp = open_memstream(out, &out_len);
+    PigStream ps;
+    if (fp == NULL || pig_stream_init(&ps, fp, buffer_size) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < len;) {
+        size_t k = 1 + below(state, below(state, 2) ? 8 : 300);
+        k = k < len - i ? k : len - i;
+        pig_stream_write(&ps, text + i, k);
+        i += k;
+    }
+    pig_stream_finish(&ps);
+    pig_stream_free(&ps);
+    fclose(fp);
+    return out_len;
+}
+
+/**
+* @brief Translates a text with one of the FILE based translators.
+* @param text The text.
+* @param len Its length.
+* @param out Receives the translation (malloc'd by open_memstream).
+* @param buffer_size The chunk size.
+* @param threads The number of threads, or -1 for pig_translate_stream.
+* @return The length of the translation.
+*/
+
+static size_t translate_file(const char *text, size_t len, char **out, size_t buffer_size, int threads) {
+    size_t out_len = 0;
+    FILE *in = fmemopen((void *) text, len, "r");
+    FILE *fp = open_memstream(out, &out_len);
+    if (in == NULL || fp == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    if (threads < 0) {
+        pig_translate_stream(in, fp, buffer_size, NULL);
+    } else {
+        pig_translate_stream_parallel(in, fp, buffer_size, threads, NULL);
+    }
+    fclose(in);
+    fclose(fp);
+    return out_len;
+}
+
+/**
+* @brief Checks the text translators against pig() on a random text.
+* @param t The totals.
+* @param state The state of the generator.
+*/
+
+static void check_text(Tally *t, uint64_t *state) {
+    static char text[TEXT_WORDS * (WORD_MAX + 8)], expected[TEXT_WORDS * (WORD_MAX + 12)];
+    static char line[TEXT_WORDS * (WORD_MAX + 8)], line_expected[TEXT_WORDS * (WORD_MAX + 12)];
+    static char out[PIG_TEXT_MAX(sizeof(text)) + PIG_LINE_MAX(sizeof(line))], kept[sizeof(expected)];
+    size_t len = 0, n = 0, line_len = 0, line_n = 0, kept_n = 0;
+    size_t words = 1 + below(state, TEXT_WORDS);
+    int leading = (int) below(state, 2);
+    for (size_t w = 0; w < words; w++) {
+        const char *sep = "";
+        if (w > 0 || leading) {
+            sep = separators[below(state, sizeof(separators) / sizeof(separators[0]))];
+            append(text, &len, sep, strlen(sep));
+            append(expected, &n, sep, strlen(sep));
+            append(line, &line_len, " ", 1);
+        }
+        char word[WORD_MAX + 1];
+        size_t k = random_word(state, word);
+        char *p = pig(word);
+        if (keeps_case(word, k)) { // the translations the reverse translator must give back
+            append(kept, &kept_n, sep, strlen(sep));
+            append(kept, &kept_n, p, strlen(p));
+        }
+        append(text, &len, word, k);
+        append(expected, &n, p, strlen(p));
+        append(line, &line_len, word, k);
+        append(line_expected, &line_n, p, strlen(p));
+        append(line_expected, &line_n, " ", 1);
+        free(p);
+    }
+
+    size_t used;
+    size_t o = pig_text(text, len, out, PIG_TEXT_MAX(len), &used);
+    check(t, "pig_text", text, len, expected, n, out, used == len ? o : (size_t) -1);
+
+    size_t cap = 8 + below(state, 200); // small buffers: translate piece by piece, as the stream does
+    o = 0;
+    for (size_t i = 0; i < len;) {
+        size_t k = pig_text(text + i, len - i, out + o, cap, &used);
+        if (used == 0) {
+            break; // a word longer than the buffer: pig_text leaves it to the caller
+        }
+        o += k;
+        i += used;
+        if (i == len) {
+            check(t, "pig_text (small buffer)", text, len, expected, n, out, o);
+        }
+    }
+
+    char *s = NULL;
+    size_t s_len = stream_pieces(state, text, len, &s, 64 + below(state, 200));
+    check(t, "pig_stream_write (random pieces)", text, len, expected, n, s, s_len);
+    free(s);
+    s_len = translate_file(text, len, &s, 64 + below(state, 500), -1);
+    check(t, "pig_translate_stream", text, len, expected, n, s, s_len);
+    free(s);
+    s_len = translate_file(text, len, &s, 64 + below(state, 500), 1 + (int) below(state, 3));
+    check(t, "pig_translate_stream_parallel", text, len, expected, n, s, s_len);
+    free(s);
+
+    long l = pig_line(NULL, line, line_len, out);
+    check(t, "pig_line", line, line_len, line_expected, line_n, out, l < 0 ? (size_t) -1 : (size_t) l);
+
+    // decode the translations in small chunks, cut inside words and UTF-8 sequences, and translate them back
+    size_t d_len = 0;
+    char *d = NULL;
+    FILE *in = kept_n > 0 ? fmemopen(kept, kept_n, "r") : fopen("/dev/null", "r");
+    FILE *fp = open_memstream(&d, &d_len);
+    PigDecodeStats stats;
+    if (in == NULL || fp == NULL || pig_decode_stream(NULL, in, fp, NULL, 64 + below(state, 200), &stats) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    fclose(in);
+    fclose(fp);
+    o = d_len <= len ? pig_text(d, d_len, out, PIG_TEXT_MAX(d_len), &used) : (size_t) -1;
+    check(t, "pig_decode_stream (round trip)", kept, kept_n, kept, kept_n, out,
+          stats.not_pig == 0 && used == d_len ? o : (size_t) -1);
+    free(d);
+}
+
+/**
+* @brief Main function: checks the known translations, then fuzzes.
+* @param argc The number of command line arguments
+* @param argv An array of strings containing the command line arguments
+* @return int 0 if every translation matched, 1 otherwise.
+*/
+
+int main(int argc, char *argv[]) {
+    long iterations = 200000;
+    uint64_t seed = 1;
+    Tally t = { 0, 0, 0, 10 };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            t.show_max = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n words] [-S seed] [-m mismatches_to_print]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t k = 0; k < sizeof(known) / sizeof(known[0]); k++) {
+        char word[WORD_MAX + 1];
+        strcpy(word, known[k][0]);
+        char *p = pig(word);
+        check(&t, "pig (known)", word, strlen(word), known[k][1], strlen(known[k][1]), p, strlen(p));
+        free(p);
+    }
+
+    for (size_t k = 0; k < sizeof(known_decoded) / sizeof(known_decoded[0]); k++) {
+        const char *token = known_decoded[k][0], *word = known_decoded[k][1];
+        char out[WORD_MAX + 1];
+        int kind;
+        long m = pig_decode_word(NULL, token, strlen(token), out, &kind);
+        check(&t, "pig_decode_word (known)", token, strlen(token), word, strlen(word), out,
+              m < 0 ? (size_t) -1 : (size_t) m);
+    }
+
+    PigCache cache;
+    if (pig_cache_init(&cache, 1024) != 0) {
+        return 1;
+    }
+    uint64_t state = seed;
+    for (long i = 0; i < iterations; i++) {
+        char word[WORD_MAX + 1];
+        size_t len = random_word(&state, word);
+        check_word(&t, &cache, &state, word, len);
+        if (i % 64 == 0) {
+            check_batch(&t, &state);
+        }
+        if (i % 256 == 0) {
+            check_text(&t, &state);
+        }
+    }
+    pig_cache_free(&cache);
+
+    printf("%ld checks, %ld mismatches (seed %llu)\n", t.checks, t.failures, (unsigned long long) seed);
+    return t.failures == 0 ? 0 : 1;
+}
+
+/* Instructions for running the program:
+ * To compile and run the fuzzer, run the following command in the terminal:
+ * make fuzz
+ *
+ * or, to pass options:
+ * make fuzz_pig
+ * ./fuzz_pig -n 1000000 -S 42
+ */
@@ -1,10 +1,15 @@
 /**
 * @file pig.c
 * @brief This file defines a function pig which takes a word in English and returns its Pig Latin translation.
-* This program defines a function pig which takes a word in English and returns its Pig Latin translation. 
+* This program defines a function pig which takes a word in English and returns its Pig Latin translation,
+* and pig_into, which does the translation into a buffer supplied by the caller without allocating. 
 * If the word starts with a vowel, "way" is appended to the end of the word. 
 * If the word starts with a consonant, the first consonant cluster is moved to the end of the word, followed by "ay".
 * If the word starts with y then it's treated a consonant else as vowel. 
+* Capitals stay in place: a capitalised word translates to a capitalised word ("Happy" -> "Appyhay"), and a word in
+* capitals to capitals ("HAPPY" -> "APPYHAY"). Characters are classified through the table pig_ctype defined here.
+* Words are UTF-8: a word with characters beyond ASCII is handed to pig_utf8.c, which knows the accented letters and
+* moves whole code points, while plain ASCII words never leave the table lookups below.
 *
 * @author Josh 
 * @bug No known bugs.
@@ -12,43 +17,212 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include<stdlib.h>
 #include "pig.h"
+#include "pig_ctype.h"
+#include "pig_simd.h"
+#include "pig_utf8.h"
+
+/** Table entries of a lower case letter c with flags f and its upper case form. */
+#define LETTER(c, f) [c] = PIG_LETTER | (f), [(c) - 'a' + 'A'] = PIG_LETTER | PIG_UPPER | (f)
+/** Flags of a vowel. */
+#define V (PIG_VOWEL | PIG_VOWEL_Y)
+/** Table entries of the bytes b to b + 3 and b to b + 15, which are all above 0x7F. */
+#define HIGH4(b) [b] = PIG_HIGH, [(b) + 1] = PIG_HIGH, [(b) + 2] = PIG_HIGH, [(b) + 3] = PIG_HIGH
+#define HIGH16(b) HIGH4(b), HIGH4((b) + 4), HIGH4((b) + 8), HIGH4((b) + 12)
+
+const unsigned char pig_ctype[256] = {
+    LETTER('a', V), LETTER('b', 0), LETTER('c', 0), LETTER('d', 0), LETTER('e', V), LETTER('f', 0), LETTER('g', 0),
+    LETTER('h', 0), LETTER('i', V), LETTER('j', 0), LETTER('k', 0), LETTER('l', 0), LETTER('m', 0), LETTER('n', 0),
+    LETTER('o', V), LETTER('p', 0), LETTER('q', 0), LETTER('r', 0), LETTER('s', 0), LETTER('t', 0), LETTER('u', V),
+    LETTER('v', 0), LETTER('w', 0), LETTER('x', 0), LETTER('y', PIG_VOWEL_Y), LETTER('z', 0),
+    [' '] = PIG_SPACE, ['\t'] = PIG_SPACE, ['\n'] = PIG_SPACE, ['\v'] = PIG_SPACE, ['\f'] = PIG_SPACE, ['\r'] = PIG_SPACE,
+    HIGH16(0x80), HIGH16(0x90), HIGH16(0xA0), HIGH16(0xB0), HIGH16(0xC0), HIGH16(0xD0), HIGH16(0xE0), HIGH16(0xF0),
+};
+
+#undef LETTER
+#undef V
+#undef HIGH4
+#undef HIGH16
+
+/** How a word is capitalised. */
+enum { CASE_AS_IS, CASE_CAPITALISED, CASE_UPPER, CASE_UTF8 };
+
+/**
+* @brief Finds how a word is capitalised.
+* Only the first letter of a word that does not start with a capital is looked at.
+* @param word The word.
+* @param len The number of characters in word.
+* @return CASE_UPPER if it has at least two letters, all capitals; CASE_CAPITALISED if it starts with a capital;
+* CASE_UTF8 if that cannot be told without decoding UTF-8; CASE_AS_IS otherwise.
+*/
+
+static inline int word_case(const char *word, size_t len) {
+    if (len == 0 || !pig_is(word[0], PIG_UPPER | PIG_HIGH)) {
+        return CASE_AS_IS;
+    }
+    if (pig_is(word[0], PIG_HIGH)) {
+        return CASE_UTF8;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (!pig_is(word[i], PIG_UPPER)) {
+            return pig_is(word[i], PIG_HIGH) ? CASE_UTF8 : CASE_CAPITALISED;
+        }
+    }
+    return len > 1 ? CASE_UPPER : CASE_CAPITALISED;
+}
+
+/**
+* @brief Moves the capitals of a translation to where they belong, for the first n characters of it.
+* A capitalised word gives its capital to the new first letter and the moved cluster starts in lower case;
+* a word in capitals gets its suffix in capitals. Words that start with a vowel, or are all consonants, keep
+* their letters where they were. Characters other than letters are never changed.
+* @param out The translation as written by rotating the word.
+* @param n The number of characters of the translation present in out.
+* @param word The word.
+* @param len The number of characters in word.
+* @param cluster The length of its consonant cluster.
+*/
+
+static inline void fix_case(char *out, size_t n, const char *word, size_t len, size_t cluster) {
+    int shape = word_case(word, len);
+    if (shape == CASE_UTF8 || (shape == CASE_CAPITALISED && n > 0 && pig_is(out[0], PIG_HIGH))) {
+        pig_utf8_fix_case(out, n, word, len, cluster);
+    } else if (shape == CASE_CAPITALISED && cluster > 0 && cluster < len) {
+        if (n > 0 && pig_is(out[0], PIG_LETTER)) {
+            out[0] &= ~0x20; // clearing 0x20 makes a letter upper case
+        }
+        if (n > len - cluster) {
+            out[len - cluster] |= 0x20; // word[0], a capital
+        }
+    } else if (shape == CASE_UPPER) {
+        for (size_t i = len; i < n; i++) {
+            out[i] &= ~0x20;
+        }
+    }
+}
+
+/**
+* @brief Copies n characters to out at offset at, dropping whatever does not fit in cap bytes.
+* @param out The output buffer.
+* @param cap The size of out in bytes.
+* @param at The offset to write at.
+* @param src The characters to copy.
+* @param n The number of characters to copy.
+* @return The offset just past the copied characters, as if they had all fit.
+*/
+
+static size_t put(char *out, size_t cap, size_t at, const char *src, size_t n) {
+    if (at < cap) {
+        size_t room = cap - at;
+        memcpy(out + at, src, n < room ? n : room);
+    }
+    return at + n;
+}
+
+/**
+* @brief This function takes a word in English and writes its Pig Latin translation into out.
+* If the first character of the word is a vowel, the translation is the word followed by "way".
+* If the first character is a consonant, the function finds the first vowel (including "y" as a vowel) and moves the consonant cluster to the end of the word, followed by "ay".
+* The word is scanned once and copied with memcpy; nothing is allocated. An empty word translates to "way".
+* The capitals of the word are moved as described at the top of this file.
+*
+* @param word A pointer to the word in English to be translated; it need not be NUL-terminated.
+* @param len The number of characters in word.
+* @param out The buffer that receives the translation.
+* @param cap The size of out in bytes; at most cap - 1 characters and a NUL are written.
+* @return The length of the whole translation, which may be larger than cap - 1 if it was truncated.
+*/
+
+size_t pig_into(const char *word, size_t len, char *out, size_t cap) {
+    size_t i = pig_cluster(word, len);
+    size_t n = put(out, cap, 0, word + i, len - i);
+    n = put(out, cap, n, word, i);
+    if (i == 0) { // if word starts with vowel
+        n = put(out, cap, n, "way", 3);
+    } else { // if word starts with consonant
+        n = put(out, cap, n, "ay", 2);
+    }
+    if (cap > 0) {
+        fix_case(out, n < cap ? n : cap - 1, word, len, i);
+        out[n < cap ? n : cap - 1] = '\0';
+    }
+    return n;
+}
+
+/**
+* @brief Writes the translation of a word whose consonant cluster is known, without a NUL and without bounds checks.
+* @param word The word.
+* @param len The number of characters in word.
+* @param cluster The length of its consonant cluster, as pig_cluster returns it.
+* @param out Where the translation is written; it must have room for len + 3 characters.
+* @return The length of the translation.
+*/
+
+size_t pig_emit(const char *word, size_t len, size_t cluster, char *out) {
+    memcpy(out, word + cluster, len - cluster);
+    memcpy(out + len - cluster, word, cluster);
+    size_t n;
+    if (cluster == 0) {
+        memcpy(out + len, "way", 3);
+        n = len + 3;
+    } else {
+        memcpy(out + len, "ay", 2);
+        n = len + 2;
+    }
+    fix_case(out, n, word, len, cluster);
+    return n;
+}
+
+/**
+* @brief Finds the leading consonant cluster of a word.
+* If the first character is a vowel the cluster is empty. Otherwise it runs up to the first vowel after the first character,
+* counting "y" as a vowel there, or to the end of the word if there is none; long words are searched with pig_find_vowel
+* a vector of characters at a time. Words with characters beyond ASCII are measured by pig_utf8_cluster.
+*
+* @param word A pointer to the word in English; it need not be NUL-terminated.
+* @param len The number of characters in word.
+* @return The length of the consonant cluster.
+*/
+
+size_t pig_cluster(const char *word, size_t len) {
+    if (len == 0 || pig_is(word[0], PIG_VOWEL)) {
+        return 0;
+    }
+    if (pig_is(word[0], PIG_HIGH)) {
+        return pig_utf8_cluster(word, len);
+    }
+    if (len > 16 && pig_is_ascii(word, len)) {
+        return 1 + pig_find_vowel(word + 1, len - 1, 1);
+    }
+    size_t i;
+    for (i = 1; i < len; i++) {
+        if (pig_is(word[i], PIG_VOWEL_Y | PIG_HIGH)) { //also added y in condition
+            if (pig_is(word[i], PIG_HIGH)) {
+                return pig_utf8_cluster(word, len);
+            }
+            break;
+        }
+    }
+    return i;
+}
 
 /**
 * @brief This function takes a word in English and returns its Pig Latin translation.
-* This function first checks if the first character of the word is a vowel. If it is, it simply appends "way" to the end of the word and returns the resulting Pig Latin word. 
-* If the first character is a consonant, the function finds the first vowel (including "y" as a vowel) and moves the consonant cluster to the end of the word, followed by "ay". 
-* The function then returns the resulting Pig Latin word.
+* The translation is written by pig_into into a newly allocated string.
 *
 * @param word A pointer to the word in English to be translated.
-* @return A pointer to the translated Pig Latin word.
+* @return A pointer to the translated Pig Latin word, which the caller must free.
 */
 
 char *pig(char *word) {
-    char *pig_word = malloc(strlen(word) + 3); // allocate memory for result string
+    size_t len = strlen(word);
+    char *pig_word = malloc(len + 4); // allocate memory for result string: at most len + 3 characters and a NUL
     if (pig_word == NULL) {
         fprintf(stderr, "Error: Memory allocation failed.\n");
         exit(1);
     }
-    if (strchr("aeiouAEIOU", word[0])) { // if word starts with vowel
-        strcpy(pig_word, word);
-        strcat(pig_word, "way");
-    } 
-    
-    else { // if word starts with consonant
-        int i, len = strlen(word);
-        for (i = 1; i < len; i++) {
-            if (strchr("aeiouyAEIOUY", word[i])) { //also added y in condition 
-                break;
-            }
-        }
-
-        strcpy(pig_word, &word[i]);
-        strncat(pig_word, word, i);
-        strcat(pig_word, "ay");
-    }
+    pig_into(word, len, pig_word, len + 4);
     return pig_word;
 }
 
@@ -56,5 +230,6 @@ char *pig(char *word) {
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
  * gcc -c pig.c -o pig.o 
+ * Programs using pig.o must be linked with pig_simd.o and pig_utf8.o.
  * 
 */ 
\ No newline at end of file
@@ -1,19 +1,59 @@
 /**
 * @file pig.h
-* @brief This header file defines the function prototype for the pig function.
-* This file defines the pig function, which takes a word in English and returns its Pig Latin translation.
+* @brief This header file defines the function prototypes for the pig and pig_into functions.
+* This file defines the pig function, which takes a word in English and returns its Pig Latin translation,
+* and pig_into, which writes the translation into a buffer supplied by the caller.
 * @author Josh
 */
 
 #ifndef PIG_H
 #define PIG_H
 
+#include <stddef.h>
+
 /**
 * @brief Translates a word in English to its Pig Latin form.
 * This function takes a word in English and returns its Pig Latin translation. If the word starts with a vowel, "way" is appended to the end of the word. If the word starts with a consonant, the first consonant cluster is moved to the end of the word, followed by "ay".
+* A capitalised word stays capitalised ("Happy" -> "Appyhay") and a word in capitals stays in capitals ("HAPPY" -> "APPYHAY").
 * @param word The word in English to be translated.
 * @return A pointer to the translated Pig Latin word.
 */
 char* pig(char* word);
 
+/**
+* @brief Translates a word in English to its Pig Latin form, writing it into a caller-supplied buffer.
+* Works like pig() but reads exactly len characters of word, which need not be NUL-terminated, and never allocates.
+* Like snprintf, at most cap - 1 characters are written followed by a NUL (nothing is written if cap is 0),
+* and the return value is the length of the whole translation, so a result >= cap means it was truncated.
+* A translation is never longer than len + 3 characters.
+* @param word The word in English to be translated.
+* @param len The number of characters in word.
+* @param out The buffer that receives the translation.
+* @param cap The size of out in bytes.
+* @return The length of the Pig Latin word, not counting the terminating NUL.
+*/
+size_t pig_into(const char* word, size_t len, char* out, size_t cap);
+
+/**
+* @brief Finds the consonant cluster that pig() moves to the end of a word.
+* The translation of word is word[i..len) followed by word[0..i) and "ay", where i is the returned length,
+* except that for i == 0 (the word starts with a vowel, or is empty) the suffix is "way".
+* @param word The word in English.
+* @param len The number of characters in word.
+* @return The length of the leading consonant cluster.
+*/
+size_t pig_cluster(const char* word, size_t len);
+
+/**
+* @brief Writes the translation of a word whose consonant cluster is already known, as pig_into would write it.
+* This is the inner step of the text translators, which find the clusters themselves: there is no NUL and no
+* bounds check, and the capitals are moved like pig() moves them ("Happy" -> "Appyhay", "HAPPY" -> "APPYHAY").
+* @param word The word.
+* @param len The number of characters in word.
+* @param cluster The length of its consonant cluster, as pig_cluster returns it.
+* @param out Where the translation is written; it must have room for len + 3 characters.
+* @return The length of the translation.
+*/
+size_t pig_emit(const char* word, size_t len, size_t cluster, char* out);
+
 #endif /* PIG_H */
@@ -0,0 +1,126 @@
+/**
+* @file pig_batch.c
+* @brief This file implements the batch translator of pig_batch.h.
+* A first pass adds up the sizes of the translations, as the length of a translation only depends on the length of
+* the word and on whether it starts with a vowel. A second pass writes every translation with pig_emit straight after
+* the one before, so the output is written sequentially into the one allocation.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pig.h"
+#include "pig_batch.h"
+#include "pig_ctype.h"
+#include "pig_utf8.h"
+
+/**
+* @brief Computes the length of the translation of a word, without translating it.
+* @param word The word.
+* @param len The number of bytes in word.
+* @return len + 3 if the word starts with a vowel (or is empty), len + 2 otherwise.
+*/
+
+static inline size_t translation_length(const char *word, size_t len) {
+    size_t n;
+    return len + (len == 0 || (pig_utf8_char(word, len, &n) & PIG_VOWEL) ? 3 : 2);
+}
+
+/**
+* @brief Allocates the offsets and bytes of a batch in one block.
+* @param batch The batch, whose count is set.
+* @param total The number of bytes of all translations and their NULs.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+static int batch_alloc(PigBatch *batch, size_t total) {
+    size_t head = (batch->count + 1) * sizeof(size_t);
+    batch->offsets = malloc(head + total);
+    if (batch->offsets == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    batch->bytes = (char *) batch->offsets + head;
+    return 0;
+}
+
+/**
+* @brief Translates an array of NUL-terminated words.
+* @param words The words.
+* @param count The number of words.
+* @param batch Receives the translations.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+int pig_batch(const char *const *words, size_t count, PigBatch *batch) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += translation_length(words[i], strlen(words[i])) + 1;
+    }
+    batch->count = count;
+    if (batch_alloc(batch, total) != 0) {
+        return -1;
+    }
+    size_t o = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(words[i]); // measuring again is cheaper than a second allocation for the lengths
+        batch->offsets[i] = o;
+        o += pig_emit(words[i], len, pig_cluster(words[i], len), batch->bytes + o);
+        batch->bytes[o++] = '\0';
+    }
+    batch->offsets[count] = o;
+    return 0;
+}
+
+/**
+* @brief Translates words packed one after another in a buffer.
+* @param bytes The words.
+* @param offsets count + 1 offsets of the words in bytes.
+* @param count The number of words.
+* @param batch Receives the translations.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+int pig_batch_packed(const char *bytes, const size_t *offsets, size_t count, PigBatch *batch) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += translation_length(bytes + offsets[i], offsets[i + 1] - offsets[i]) + 1;
+    }
+    batch->count = count;
+    if (batch_alloc(batch, total) != 0) {
+        return -1;
+    }
+    size_t o = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *word = bytes + offsets[i];
+        size_t len = offsets[i + 1] - offsets[i];
+        batch->offsets[i] = o;
+        o += pig_emit(word, len, pig_cluster(word, len), batch->bytes + o);
+        batch->bytes[o++] = '\0';
+    }
+    batch->offsets[count] = o;
+    return 0;
+}
+
+/**
+* @brief Frees the translations of a batch.
+* @param batch The batch.
+*/
+
+void pig_batch_free(PigBatch *batch) {
+    free(batch->offsets); // the bytes are in the same allocation
+    batch->offsets = NULL;
+    batch->bytes = NULL;
+    batch->count = 0;
+}
+
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_batch.c -o pig_batch.o
+ * Programs using pig_batch.o must be linked with pig.o, pig_simd.o and pig_utf8.o.
+ *
+*/
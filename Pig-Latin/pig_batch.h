@@ -0,0 +1,62 @@
+/**
+* @file pig_batch.h
+* @brief This header file defines the batch translator, which translates many words into a single buffer.
+* Translating word by word with pig() allocates once per word. The batch functions work out the exact size of all
+* the translations first (each is the word plus "ay" or "way"), make one allocation, and write the translations one
+* after another into it, with an array of offsets to find them.
+* @author Josh
+*/
+
+#ifndef PIG_BATCH_H
+#define PIG_BATCH_H
+
+#include <stddef.h>
+
+/**
+* @brief The translations of a batch of words.
+* Translation i is the NUL-terminated string at bytes + offsets[i], and offsets[i + 1] - offsets[i] - 1 is its length.
+* The offsets and the bytes are one allocation.
+*/
+typedef struct {
+    size_t count;       /**< Number of words. */
+    size_t *offsets;    /**< count + 1 offsets into bytes. */
+    char *bytes;        /**< The translations, each followed by a NUL. */
+} PigBatch;
+
+/**
+* @brief Translates an array of NUL-terminated words.
+* @param words The words.
+* @param count The number of words.
+* @param batch Receives the translations; free them with pig_batch_free.
+* @return 0 on success, -1 if memory could not be allocated (a message is printed to stderr).
+*/
+int pig_batch(const char *const *words, size_t count, PigBatch *batch);
+
+/**
+* @brief Translates words packed one after another in a buffer, such as a tokenised text.
+* Word i is bytes[offsets[i]..offsets[i + 1]); the words need not be NUL-terminated.
+* @param bytes The words.
+* @param offsets count + 1 offsets of the words in bytes.
+* @param count The number of words.
+* @param batch Receives the translations; free them with pig_batch_free.
+* @return 0 on success, -1 if memory could not be allocated (a message is printed to stderr).
+*/
+int pig_batch_packed(const char *bytes, const size_t *offsets, size_t count, PigBatch *batch);
+
+/**
+* @brief Returns translation i of a batch.
+* @param batch The batch.
+* @param i The number of the word.
+* @return The NUL-terminated translation.
+*/
+static inline const char *pig_batch_word(const PigBatch *batch, size_t i) {
+    return batch->bytes + batch->offsets[i];
+}
+
+/**
+* @brief Frees the translations of a batch.
+* @param batch The batch.
+*/
+void pig_batch_free(PigBatch *batch);
+
+#endif /* PIG_BATCH_H */
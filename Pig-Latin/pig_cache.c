@@ -0,0 +1,241 @@
+/**
+* @file pig_cache.c
+* @brief This file implements the translation cache of pig_cache.h.
+* The slots form an open-addressing table with linear probing over at most PROBE_LIMIT slots. Each slot holds the
+* hash, the word and its translation in one 64-byte line, so a hit touches a single cache line and is finished
+* with one memcpy. Nothing is ever evicted: words that arrive when their probe window is full stay uncached.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pig.h"
+#include "pig_cache.h"
+#include "pig_ctype.h"
+#include "pig_utf8.h"
+
+/** The number of slots looked at before a word is given up on. */
+#define PROBE_LIMIT 8
+
+/**
+* @brief Hashes a word with 32-bit FNV-1a.
+* @param word The word.
+* @param len The number of letters in word.
+* @return The hash.
+*/
+
+static uint32_t hash_word(const char *word, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char) word[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+* @brief Writes the translation of a word to out, which must have room for len + 3 bytes.
+* @param word The word.
+* @param len The number of letters in word.
+* @param out Where the translation is written; it is not NUL-terminated.
+* @return The length of the translation.
+*/
+
+static size_t translate(const char *word, size_t len, char *out) {
+    return pig_emit(word, len, pig_cluster(word, len), out);
+}
+
+/**
+* @brief Creates an empty cache.
+* @param cache The cache to initialise.
+* @param slots The number of slots, rounded up to a power of 2 (at least 64).
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+int pig_cache_init(PigCache *cache, size_t slots) {
+    size_t n = 64;
+    while (n < slots) {
+        n *= 2;
+    }
+    memset(cache, 0, sizeof(*cache));
+    cache->entries = aligned_alloc(64, n * sizeof(PigCacheEntry));
+    if (cache->entries == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    memset(cache->entries, 0, n * sizeof(PigCacheEntry));
+    cache->mask = n - 1;
+    return 0;
+}
+
+/**
+* @brief Creates a cache holding the same words as another, with its counters at zero.
+* @param cache The cache to initialise.
+* @param from The cache to copy.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+int pig_cache_clone(PigCache *cache, const PigCache *from) {
+    if (pig_cache_init(cache, from->mask + 1) != 0) {
+        return -1;
+    }
+    memcpy(cache->entries, from->entries, (from->mask + 1) * sizeof(PigCacheEntry));
+    cache->used = from->used;
+    return 0;
+}
+
+/**
+* @brief Frees the slots of a cache.
+* @param cache The cache.
+*/
+
+void pig_cache_free(PigCache *cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+/**
+* @brief Looks a word up, and translates and stores it if it is not there.
+* @param cache The cache.
+* @param word The word.
+* @param len The number of letters in word.
+* @param out Where the translation is written, with room for len + 3 bytes.
+* @param hit Receives 1 if the word was found, 0 otherwise.
+* @param stored Receives 1 if the word was found or stored, 0 if it could not be cached.
+* @return The length of the translation.
+*/
+
+static size_t lookup(PigCache *cache, const char *word, size_t len, char *out, int *hit, int *stored) {
+    *hit = 0;
+    *stored = 0;
+    if (len == 0 || len > PIG_CACHE_WORD_MAX) {
+        return translate(word, len, out);
+    }
+    uint32_t h = hash_word(word, len);
+    for (size_t k = 0; k < PROBE_LIMIT; k++) {
+        PigCacheEntry *e = &cache->entries[(h + k) & cache->mask];
+        if (e->len == 0) { // the word is not cached: translate it into the free slot
+            e->hash = h;
+            e->len = (uint8_t) len;
+            memcpy(e->word, word, len);
+            e->out_len = (uint8_t) translate(word, len, e->translation);
+            cache->used++;
+            *stored = 1;
+            memcpy(out, e->translation, e->out_len);
+            return e->out_len;
+        }
+        if (e->hash == h && e->len == len && memcmp(e->word, word, len) == 0) {
+            *hit = 1;
+            *stored = 1;
+            memcpy(out, e->translation, e->out_len);
+            return e->out_len;
+        }
+    }
+    return translate(word, len, out);
+}
+
+/**
+* @brief Writes the translation of a word to out, from the cache if it is there; otherwise translates and caches it.
+* @param cache The cache.
+* @param word The word.
+* @param len The number of letters in word.
+* @param out Where the translation is written, with room for len + 3 bytes.
+* @return The length of the translation.
+*/
+
+size_t pig_cache_translate(PigCache *cache, const char *word, size_t len, char *out) {
+    int hit, stored;
+    size_t n = lookup(cache, word, len, out, &hit, &stored);
+    if (hit) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+        cache->full += !stored;
+    }
+    return n;
+}
+
+/**
+* @brief Adds the words in a run of letters and UTF-8 bytes read from a word list.
+* @param cache The cache.
+* @param text The run.
+* @param len The number of bytes in the run.
+* @return The number of words added.
+*/
+
+static long load_words(PigCache *cache, const char *text, size_t len) {
+    char out[PIG_CACHE_WORD_MAX + 4];
+    long added = 0;
+    size_t i = pig_utf8_span_nonletters(text, len);
+    while (i < len) {
+        size_t j = i + pig_utf8_span_letters(text + i, len - i);
+        int hit, stored;
+        lookup(cache, text + i, j - i, out, &hit, &stored);
+        added += stored && !hit;
+        i = j + pig_utf8_span_nonletters(text + j, len - j);
+    }
+    return added;
+}
+
+/**
+* @brief Fills a cache with the words of a word list.
+* @param cache The cache.
+* @param path The word list.
+* @return The number of words added, or -1 if the file could not be read.
+*/
+
+long pig_cache_load(PigCache *cache, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    char word[PIG_CACHE_WORD_MAX + 1];
+    size_t len = 0;
+    long added = 0;
+    int c;
+    do {
+        c = getc(fp);
+        if (c != EOF && pig_is((char) c, PIG_LETTER | PIG_HIGH)) {
+            if (len <= PIG_CACHE_WORD_MAX) { // longer words are counted as too long and skipped
+                word[len] = (char) c;
+            }
+            len++;
+        } else if (len > 0) {
+            if (len <= PIG_CACHE_WORD_MAX) {
+                added += load_words(cache, word, len);
+            }
+            len = 0;
+        }
+    } while (c != EOF);
+    if (ferror(fp)) {
+        perror(path);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return added;
+}
+
+/**
+* @brief Prints the counters of a cache.
+* @param cache The cache.
+* @param fp Where to print them.
+*/
+
+void pig_cache_print_stats(const PigCache *cache, FILE *fp) {
+    unsigned long long lookups = cache->hits + cache->misses;
+    fprintf(fp, "cache: %llu lookups, %llu hits (%.1f%%), %llu not cacheable, %zu of %zu slots used\n",
+            lookups, cache->hits, lookups > 0 ? 100.0 * cache->hits / lookups : 0.0, cache->full,
+            cache->used, cache->mask + 1);
+}
+
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_cache.c -o pig_cache.o
+ * Programs using pig_cache.o must be linked with pig.o, pig_simd.o and pig_utf8.o.
+ *
+*/
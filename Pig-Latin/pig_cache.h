@@ -0,0 +1,97 @@
+/**
+* @file pig_cache.h
+* @brief This header file defines a fixed-size cache of Pig Latin translations of frequent words.
+* Text is dominated by a few words ("the", "and", "of"), so a small open-addressing hash table of word -> translation
+* in front of the translator turns most words into one hash lookup and one memcpy. Words are cached exactly as
+* written, so "The" and "the" are separate entries, as their translations differ. The table never grows: a word that
+* finds no free slot near its hash, or that is longer than PIG_CACHE_WORD_MAX, is simply translated every time.
+* A cache is not thread-safe; give each thread its own copy (pig_cache_clone) and add up the counters afterwards.
+* In this translator a hit costs about as much as translating the word, which only takes a vowel search and a few
+* copies, so the cache is an opt-in: its counters show how repetitive a text is, and it pays off wherever the
+* translation of a word gets more expensive than a hash lookup.
+* @author Josh
+*/
+
+#ifndef PIG_CACHE_H
+#define PIG_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** The longest word that is cached; with it a PigCacheEntry is 64 bytes. */
+#define PIG_CACHE_WORD_MAX 27
+
+/**
+* @brief A cached word and its translation, in one cache line.
+*/
+typedef struct {
+    uint32_t hash;                              /**< Hash of the word. */
+    uint8_t len;                                /**< Length of the word, or 0 if the slot is empty. */
+    uint8_t out_len;                            /**< Length of the translation. */
+    char word[PIG_CACHE_WORD_MAX];              /**< The word. */
+    char translation[PIG_CACHE_WORD_MAX + 3];   /**< Its translation, not NUL-terminated. */
+} PigCacheEntry;
+
+/**
+* @brief A translation cache and its hit counters.
+*/
+typedef struct {
+    PigCacheEntry *entries;     /**< The slots; their number is a power of 2. */
+    size_t mask;                /**< Number of slots - 1. */
+    size_t used;                /**< Number of occupied slots. */
+    unsigned long long hits;    /**< Lookups that found their word. */
+    unsigned long long misses;  /**< Lookups that had to translate their word. */
+    unsigned long long full;    /**< Misses whose word could not be stored (too long, or no free slot). */
+} PigCache;
+
+/**
+* @brief Creates an empty cache.
+* @param cache The cache to initialise.
+* @param slots The number of slots, rounded up to a power of 2 (at least 64). Each slot takes 64 bytes.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+int pig_cache_init(PigCache *cache, size_t slots);
+
+/**
+* @brief Creates a cache holding the same words as another, with its counters at zero.
+* @param cache The cache to initialise.
+* @param from The cache to copy.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+int pig_cache_clone(PigCache *cache, const PigCache *from);
+
+/**
+* @brief Frees the slots of a cache.
+* @param cache The cache.
+*/
+void pig_cache_free(PigCache *cache);
+
+/**
+* @brief Writes the translation of a word to out, from the cache if it is there; otherwise translates and caches it.
+* @param cache The cache.
+* @param word The word, a run of letters; it need not be NUL-terminated.
+* @param len The number of letters in word.
+* @param out Where the translation is written; it must have room for len + 3 bytes and is not NUL-terminated.
+* @return The length of the translation.
+*/
+size_t pig_cache_translate(PigCache *cache, const char *word, size_t len, char *out);
+
+/**
+* @brief Fills a cache with the words of a word list, so that they are hits from the first lookup on.
+* Words are separated by anything that is not a letter (accented letters in UTF-8 included); put the most frequent words first, as a full cache
+* keeps the words it already holds. The counters are not changed.
+* @param cache The cache.
+* @param path The word list.
+* @return The number of words added, or -1 if the file could not be read (a message is printed to stderr).
+*/
+long pig_cache_load(PigCache *cache, const char *path);
+
+/**
+* @brief Prints the counters of a cache: lookups, hit rate and occupancy.
+* @param cache The cache.
+* @param fp Where to print them.
+*/
+void pig_cache_print_stats(const PigCache *cache, FILE *fp);
+
+#endif /* PIG_CACHE_H */
@@ -0,0 +1,38 @@
+/**
+* @file pig_ctype.h
+* @brief This header file defines the character classes the Pig Latin translator works with, as one lookup table.
+* Every byte has a set of flags in pig_ctype (defined in pig.c): letters are the ASCII letters only, whatever the
+* locale, and the vowels a, e, i, o, u and y are flagged in both cases. One table load replaces the chains of
+* comparisons, strchr and locale-dependent isalpha calls the hot loops would otherwise run per character.
+* The bytes of UTF-8 sequences are flagged PIG_HIGH, which sends a word to the UTF-8 functions of pig_utf8.h.
+* @author Josh
+*/
+
+#ifndef PIG_CTYPE_H
+#define PIG_CTYPE_H
+
+/** Flags of the character classes. */
+enum {
+    PIG_LETTER = 1,     /**< A-Z and a-z. */
+    PIG_UPPER = 2,      /**< A-Z. */
+    PIG_VOWEL = 4,      /**< a, e, i, o, u in either case. */
+    PIG_VOWEL_Y = 8,    /**< The vowels and y in either case: the vowels that end a consonant cluster. */
+    PIG_SPACE = 16,     /**< Space, tab, newline, vertical tab, form feed and carriage return. */
+    PIG_HIGH = 32       /**< Bytes 0x80 to 0xFF, the bytes of the characters beyond ASCII. */
+};
+
+/** The flags of every byte. */
+extern const unsigned char pig_ctype[256];
+
+/**
+* @brief Checks whether a byte is in a character class.
+* @param c The byte.
+* @param flags One or more of the PIG_ flags.
+* @return Nonzero if c has any of the flags.
+*/
+
+static inline int pig_is(char c, int flags) {
+    return pig_ctype[(unsigned char) c] & flags;
+}
+
+#endif /* PIG_CTYPE_H */
@@ -0,0 +1,666 @@
+/**
+* @file pig_reverse.c
+* @brief This file implements the reverse translator and its dictionary, declared in pig_reverse.h.
+* A token ending in "ay" or "way" can only have come from a few English words: the token without "way" if that starts
+* with a vowel, and the token without "ay" with its last k consonants moved back to the front, for every k that gives
+* a consonant cluster pig() would have moved. Each such word is looked up in the dictionary, a hash table laid out
+* exactly as its file, so that a saved dictionary is used by mapping the file without any parsing.
+* Tokens are UTF-8 and are split, cut and lowered with the functions of pig_utf8.h, so the accented words pig() makes
+* ("afécay", "Andúñay") decode too; a form never cuts a letter in two.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#define _POSIX_C_SOURCE 200809L /* mmap */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pig_ctype.h"
+#include "pig_reverse.h"
+#include "pig_utf8.h"
+
+/** The byte order mark of a dictionary. */
+#define BYTE_ORDER_MARK 0x01020304u
+
+/** The most words that fit a token listed in a line of the report. */
+#define REPORT_MAX 8
+
+/**
+* @brief Hashes a word with 32-bit FNV-1a.
+* @param word The word.
+* @param len The number of letters in word.
+* @return The hash.
+*/
+
+static uint32_t hash_word(const char *word, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char) word[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+* @brief Computes the size of a dictionary from its header.
+* @param h The header.
+* @return The size in bytes of the header, the slots, the offsets and the strings.
+*/
+
+static size_t dict_size(const PigDictHeader *h) {
+    return sizeof(PigDictHeader) + 2 * sizeof(uint32_t) * h->nslots + sizeof(uint32_t) * ((size_t) h->nwords + 1)
+         + h->strings_size;
+}
+
+/**
+* @brief Points the fields of a dictionary at the parts of its data.
+* @param dict The dictionary, whose data and size are set.
+*/
+
+static void dict_attach(PigDict *dict) {
+    dict->header = dict->data;
+    dict->slots = (const uint32_t *) (dict->header + 1);
+    dict->offsets = dict->slots + 2 * (size_t) dict->header->nslots;
+    dict->strings = (const char *) (dict->offsets + dict->header->nwords + 1);
+}
+
+/**
+* @brief Checks that the tables of a mapped dictionary stay inside it, so a damaged file cannot make lookups read
+* past its end or probe forever.
+* @param dict The dictionary, attached.
+* @return 0 if every slot names a word or is empty, at least one slot is empty, and the offsets rise and end within
+* the strings; -1 otherwise.
+*/
+
+static int dict_check(const PigDict *dict) {
+    const PigDictHeader *h = dict->header;
+    uint32_t empty = 0;
+    for (uint32_t s = 0; s < h->nslots; s++) {
+        uint32_t w = dict->slots[2 * s + 1];
+        if (w > h->nwords) {
+            return -1;
+        }
+        empty += w == 0;
+    }
+    if (empty == 0 || dict->offsets[0] != 0) {
+        return -1;
+    }
+    for (uint32_t w = 0; w < h->nwords; w++) {
+        if (dict->offsets[w + 1] < dict->offsets[w]) {
+            return -1;
+        }
+    }
+    return dict->offsets[h->nwords] <= h->strings_size ? 0 : -1;
+}
+
+/**
+* @brief Builds a dictionary in memory from the words of a text.
+* @param dict The dictionary to build.
+* @param text The word list.
+* @param len The size of the word list.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+static int dict_build(PigDict *dict, const char *text, size_t len) {
+    size_t words = 0, letters = 0;
+    for (size_t i = pig_utf8_span_nonletters(text, len); i < len; ) {
+        size_t j = i + pig_utf8_span_letters(text + i, len - i);
+        words++;
+        letters += j - i;
+        i = j + pig_utf8_span_nonletters(text + j, len - j);
+    }
+    if (words >= (1u << 30) || letters > UINT32_MAX) {
+        fprintf(stderr, "Error: The word list is too large.\n");
+        return -1;
+    }
+    uint32_t nslots = 16;
+    while (nslots < 2 * words) { // at most half full, so probes stay short and always reach an empty slot
+        nslots *= 2;
+    }
+    PigDictHeader h = { PIG_DICT_MAGIC, BYTE_ORDER_MARK, nslots, (uint32_t) words, (uint32_t) letters };
+    dict->size = dict_size(&h);
+    dict->data = calloc(1, dict->size);
+    if (dict->data == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    dict->mapped = 0;
+    memcpy(dict->data, &h, sizeof(h));
+    dict_attach(dict);
+
+    uint32_t *slots = (uint32_t *) dict->slots;
+    uint32_t *offsets = (uint32_t *) dict->offsets;
+    char *strings = (char *) dict->strings;
+    uint32_t n = 0, pos = 0;
+    for (size_t i = pig_utf8_span_nonletters(text, len); i < len; ) {
+        size_t j = i + pig_utf8_span_letters(text + i, len - i);
+        size_t wlen = j - i;
+        pig_utf8_lower(text + i, wlen, strings + pos);
+        uint32_t hash = hash_word(strings + pos, wlen);
+        uint32_t s = hash & (nslots - 1);
+        while (slots[2 * s + 1] != 0) {
+            uint32_t w = slots[2 * s + 1] - 1;
+            if (slots[2 * s] == hash && offsets[w + 1] - offsets[w] == wlen
+                    && memcmp(strings + offsets[w], strings + pos, wlen) == 0) {
+                break; // a repeated word keeps its first place
+            }
+            s = (s + 1) & (nslots - 1);
+        }
+        if (slots[2 * s + 1] == 0) {
+            slots[2 * s] = hash;
+            slots[2 * s + 1] = n + 1;
+            offsets[n] = pos;
+            pos += (uint32_t) wlen;
+            offsets[++n] = pos;
+        }
+        i = j + pig_utf8_span_nonletters(text + j, len - j);
+    }
+
+    // repeated words leave the offsets and strings shorter than counted: close the gaps
+    PigDictHeader *header = dict->data;
+    header->nwords = n;
+    header->strings_size = pos;
+    memmove(offsets + n + 1, strings, pos);
+    dict->size = dict_size(header);
+    dict_attach(dict);
+    return 0;
+}
+
+/**
+* @brief Opens a dictionary: a saved one is mapped, anything else is read as a word list.
+* @param dict The dictionary to open.
+* @param path The file.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_dict_open(PigDict *dict, const char *path) {
+    memset(dict, 0, sizeof(*dict));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t size = (size_t) st.st_size;
+    char *text = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    if (size >= sizeof(PigDictHeader) && memcmp(text, PIG_DICT_MAGIC, 8) == 0) {
+        PigDictHeader h;
+        memcpy(&h, text, sizeof(h));
+        if (h.byte_order != BYTE_ORDER_MARK || h.nslots == 0 || (h.nslots & (h.nslots - 1)) != 0
+                || h.nwords >= h.nslots || dict_size(&h) != size) {
+            fprintf(stderr, "%s: not a dictionary saved on this kind of machine.\n", path);
+            munmap(text, size);
+            return -1;
+        }
+        dict->data = text;
+        dict->size = size;
+        dict->mapped = 1;
+        dict_attach(dict);
+        if (dict_check(dict) != 0) {
+            fprintf(stderr, "%s: damaged dictionary.\n", path);
+            pig_dict_close(dict);
+            return -1;
+        }
+        return 0;
+    }
+    int status = dict_build(dict, text != NULL ? text : "", size);
+    if (text != NULL) {
+        munmap(text, size);
+    }
+    return status;
+}
+
+/**
+* @brief Saves a dictionary so that pig_dict_open can map it.
+* The file is written under a temporary name and renamed, so readers never see half of it.
+* @param dict The dictionary.
+* @param path The file to write.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_dict_save(const PigDict *dict, const char *path) {
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp = malloc(tmp_len);
+    if (tmp == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    int status = 0;
+    if (fp == NULL || fwrite(dict->data, 1, dict->size, fp) != dict->size) {
+        status = -1;
+    }
+    if (fp != NULL && fclose(fp) != 0) {
+        status = -1;
+    }
+    if (status == 0 && rename(tmp, path) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        perror(path);
+        remove(tmp);
+    }
+    free(tmp);
+    return status;
+}
+
+/**
+* @brief Unmaps or frees a dictionary.
+* @param dict The dictionary.
+*/
+
+void pig_dict_close(PigDict *dict) {
+    if (dict->mapped) {
+        munmap(dict->data, dict->size);
+    } else {
+        free(dict->data);
+    }
+    memset(dict, 0, sizeof(*dict));
+}
+
+/**
+* @brief Looks a word up in a dictionary.
+* @param dict The dictionary.
+* @param word The word, in lower case.
+* @param len The number of letters in word.
+* @return The position of the word in the word list, or -1 if it is not there.
+*/
+
+long pig_dict_find(const PigDict *dict, const char *word, size_t len) {
+    uint32_t hash = hash_word(word, len);
+    uint32_t mask = dict->header->nslots - 1;
+    for (uint32_t s = hash & mask; dict->slots[2 * s + 1] != 0; s = (s + 1) & mask) {
+        uint32_t w = dict->slots[2 * s + 1] - 1;
+        if (dict->slots[2 * s] == hash && dict->offsets[w + 1] - dict->offsets[w] == len
+                && memcmp(dict->strings + dict->offsets[w], word, len) == 0) {
+            return (long) w;
+        }
+    }
+    return -1;
+}
+
+/**
+* @brief The English words that may have given a token, as a range of forms.
+* Form 0 is the token without "way"; form k > 0 is the token without "ay" with its last k bytes moved to the front,
+* for the k that end on a letter boundary.
+*/
+typedef struct {
+    int way;        /**< 1 if form 0 fits. */
+    size_t first;   /**< The first form k > 0 that fits. */
+    size_t last;    /**< The last form k > 0 that fits; no form k > 0 fits if last < first. */
+} Forms;
+
+/**
+* @brief Checks whether a byte of a token is the second byte of a letter; the letters beyond ASCII are two bytes long.
+* @param c The byte.
+* @return Nonzero if c is a UTF-8 continuation byte.
+*/
+
+static inline int continues(char c) {
+    return ((unsigned char) c & 0xC0) == 0x80;
+}
+
+/**
+* @brief Classifies the letter that ends at an offset of a token.
+* @param token The token, a run of letters.
+* @param end The offset just past the letter, at least 1.
+* @param n Receives the number of bytes of the letter.
+* @return Its pig_ctype flags.
+*/
+
+static int letter_before(const char *token, size_t end, size_t *n) {
+    if (end < 2 || !continues(token[end - 1])) {
+        *n = 1;
+        return pig_ctype[(unsigned char) token[end - 1]];
+    }
+    return pig_utf8_char(token + end - 2, 2, n);
+}
+
+/**
+* @brief Writes a token in lower case; its ASCII part is lowered here, the rest by pig_utf8_lower.
+* @param token The token, a run of letters.
+* @param len The number of bytes of it.
+* @param lower Receives the token in lower case, len bytes.
+*/
+
+static void lower_token(const char *token, size_t len, char *lower) {
+    for (size_t i = 0; i < len; i++) {
+        if (pig_is(token[i], PIG_HIGH)) {
+            pig_utf8_lower(token + i, len - i, lower + i);
+            return;
+        }
+        lower[i] = token[i] | 0x20;
+    }
+}
+
+/**
+* @brief Finds the forms of a token that pig() could have made.
+* A moved cluster starts with a letter that is not a vowel and goes on with letters that are neither vowels nor y,
+* and it is followed by a vowel or y, unless it is the whole word.
+* @param lower The token in lower case.
+* @param len The number of bytes of it.
+* @return The forms that fit.
+*/
+
+static Forms find_forms(const char *lower, size_t len) {
+    Forms f = { 0, 1, 0 };
+    if (len < 3 || memcmp(lower + len - 2, "ay", 2) != 0) {
+        return f;
+    }
+    size_t head_len = 1, n;
+    int head = pig_is(lower[0], PIG_HIGH) ? pig_utf8_char(lower, len, &head_len) : pig_ctype[(unsigned char) lower[0]];
+    f.way = len > 3 && lower[len - 3] == 'w' && (head & PIG_VOWEL);
+    size_t body = len - 2;
+    size_t j = body;
+    while (j > 0 && !(letter_before(lower, j, &n) & PIG_VOWEL_Y)) {
+        j -= n;
+    }
+    if (j > 0 && !(letter_before(lower, j, &n) & PIG_VOWEL)) { // a y can start the cluster
+        j -= n;
+    }
+    size_t longest = body - j; // clusters of 1..longest bytes are made of the right letters
+    if (head & PIG_VOWEL_Y) {
+        f.last = longest < body ? longest : body - head_len;
+    }
+    if (longest == body) { // the whole word is a cluster
+        f.last = body;
+        if (!(head & PIG_VOWEL_Y)) {
+            f.first = body;
+        }
+    }
+    if (f.first < body && continues(lower[body - f.first])) {
+        f.first++; // a one-byte cluster would cut the last letter in two
+    }
+    return f;
+}
+
+/**
+* @brief Steps to the next form of a token, skipping the ones that would cut a letter in two.
+* @param lower The token in lower case.
+* @param len The number of bytes of it.
+* @param f Its forms.
+* @param form The current form.
+* @return The next form; past f->last if there is none.
+*/
+
+static size_t next_form(const char *lower, size_t len, const Forms *f, size_t form) {
+    form = form == 0 ? f->first : form + 1;
+    while (form <= f->last && continues(lower[len - 2 - form])) {
+        form++;
+    }
+    return form;
+}
+
+/**
+* @brief Writes one form of a token.
+* @param src The token, as it is or in lower case.
+* @param len The number of bytes of it.
+* @param form The form.
+* @param out Receives the word.
+* @return The length of the word.
+*/
+
+static size_t spell(const char *src, size_t len, size_t form, char *out) {
+    if (form == 0) {
+        memcpy(out, src, len - 3);
+        return len - 3;
+    }
+    size_t body = len - 2;
+    memcpy(out, src + body - form, form);
+    memcpy(out + form, src, body - form);
+    return body;
+}
+
+/**
+* @brief Decodes a token with scratch space supplied by the caller.
+* @param dict The dictionary, or NULL.
+* @param token The token.
+* @param len The number of bytes of it.
+* @param out Receives the English word, with room for len bytes.
+* @param kind Receives what the token was.
+* @param lower Scratch space for len bytes.
+* @param word Scratch space for len bytes.
+* @return The length of the English word in bytes.
+*/
+
+static size_t decode(const PigDict *dict, const char *token, size_t len, char *out, int *kind,
+                     char *lower, char *word) {
+    lower_token(token, len, lower);
+    Forms f = find_forms(lower, len);
+    size_t fits = 0, found = 0, choice = 0;
+    long best = -1;
+    // form 0 first if it fits, then forms first..last
+    for (size_t form = f.way ? 0 : f.first; form <= f.last || form == 0; form = next_form(lower, len, &f, form)) {
+        if (fits++ == 0) {
+            choice = form;
+        }
+        if (dict != NULL) {
+            size_t n = spell(lower, len, form, word);
+            long rank = pig_dict_find(dict, word, n);
+            if (rank >= 0) {
+                found++;
+                if (best < 0 || rank < best) {
+                    best = rank;
+                    choice = form;
+                }
+            }
+        }
+    }
+    if (fits == 0) {
+        *kind = PIG_NOT_PIG;
+        memcpy(out, token, len);
+        return len;
+    }
+    if (dict == NULL) {
+        *kind = fits > 1 ? PIG_AMBIGUOUS : PIG_DECODED;
+    } else {
+        *kind = found == 0 ? PIG_UNKNOWN : found > 1 ? PIG_AMBIGUOUS : PIG_DECODED;
+    }
+
+    size_t n = spell(token, len, choice, out);
+    if (choice == 0 || choice == n || !pig_is(token[0], PIG_UPPER | PIG_HIGH)) {
+        return n;
+    }
+    // pig() gave the capital of word[0] to word[choice] unless the word was all capitals or all consonants
+    size_t i = 1;
+    while (i < n && pig_is(token[i], PIG_UPPER)) {
+        i++;
+    }
+    if (pig_is(token[0], PIG_HIGH) || pig_is(out[0], PIG_HIGH) || (i < n && pig_is(token[i], PIG_HIGH))) {
+        pig_utf8_fix_case(out, n, token, n, n - choice); // rotating back is the same fix with the other cluster
+    } else if (i < n) {
+        out[0] &= ~0x20;
+        out[choice] |= 0x20;
+    }
+    return n;
+}
+
+/**
+* @brief Decodes one Pig Latin word.
+* @param dict The dictionary, or NULL.
+* @param token The Pig Latin word.
+* @param len The number of bytes of token.
+* @param out Receives the English word, with room for len bytes.
+* @param kind Receives what the token was.
+* @return The length of the English word, or -1 if memory could not be allocated.
+*/
+
+long pig_decode_word(const PigDict *dict, const char *token, size_t len, char *out, int *kind) {
+    char small[2 * 64];
+    char *scratch = len <= 64 ? small : malloc(2 * len);
+    if (scratch == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    size_t n = decode(dict, token, len, out, kind, scratch, scratch + len);
+    if (scratch != small) {
+        free(scratch);
+    }
+    return (long) n;
+}
+
+/**
+* @brief Writes the report line of a token that was not decoded to one word.
+* @param report Where to write it.
+* @param dict The dictionary, or NULL.
+* @param offset The offset of the token in the input.
+* @param kind What the token was.
+* @param token The token.
+* @param len The number of bytes of it.
+* @param choice The word chosen.
+* @param n The length of the word chosen.
+* @param lower Scratch space for len bytes.
+* @param word Scratch space for len bytes.
+*/
+
+static void report_token(FILE *report, const PigDict *dict, unsigned long long offset, int kind, const char *token,
+                         size_t len, const char *choice, size_t n, char *lower, char *word) {
+    static const char *const names[] = { "decoded", "ambiguous", "unknown", "not-pig-latin" };
+    fprintf(report, "%llu\t%s\t%.*s\t%.*s\t", offset, names[kind], (int) len, token, (int) n, choice);
+    lower_token(token, len, lower);
+    Forms f = find_forms(lower, len);
+    int listed = 0;
+    for (size_t form = f.way ? 0 : f.first; form <= f.last || form == 0; form = next_form(lower, len, &f, form)) {
+        size_t k = spell(lower, len, form, word);
+        if (kind == PIG_AMBIGUOUS && dict != NULL && pig_dict_find(dict, word, k) < 0) {
+            continue; // list only the dictionary words that fit
+        }
+        if (listed == REPORT_MAX) {
+            fputs(",...", report);
+            break;
+        }
+        fprintf(report, "%s%.*s", listed++ > 0 ? "," : "", (int) k, word);
+    }
+    fputc('\n', report);
+}
+
+/**
+* @brief Decodes a whole text.
+* The input is read in chunks that are cut before the letters at their end, which start the next chunk,
+* and the English text of each chunk is written with one fwrite (it is never longer than the chunk).
+* @param dict The dictionary, or NULL.
+* @param in The Pig Latin text.
+* @param out Receives the English text.
+* @param report Receives the report, or NULL.
+* @param buffer_size The size of the chunks.
+* @param stats Receives the counts of the tokens.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_decode_stream(const PigDict *dict, FILE *in, FILE *out, FILE *report, size_t buffer_size,
+                      PigDecodeStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    size_t cap = buffer_size < 64 ? 64 : buffer_size;
+    char *buf = malloc(cap), *obuf = malloc(cap), *scratch = malloc(2 * cap);
+    int status = 0;
+    size_t keep = 0;
+    unsigned long long offset = 0;
+    while (status == 0) {
+        if (buf == NULL || obuf == NULL || scratch == NULL) {
+            fprintf(stderr, "Error: Memory allocation failed.\n");
+            status = -1;
+            break;
+        }
+        size_t got = fread(buf + keep, 1, cap - keep, in);
+        size_t total = keep + got, end = total;
+        int last = keep + got < cap; // fread stops short only at the end of the input or on an error
+        if (last && ferror(in)) {
+            perror("Failed to read input");
+            status = -1;
+            break;
+        }
+        if (!last) {
+            end = pig_utf8_word_start(buf, total);
+            if (end == 0) { // a single word fills the buffer: make room for more of it
+                char *grown = realloc(buf, 2 * cap);
+                if (grown == NULL) {
+                    fprintf(stderr, "Error: Memory allocation failed.\n");
+                    status = -1;
+                    break;
+                }
+                buf = grown;
+                cap *= 2;
+                free(obuf);
+                free(scratch);
+                obuf = malloc(cap);
+                scratch = malloc(2 * cap);
+                keep = total;
+                continue;
+            }
+        }
+
+        size_t o = 0;
+        for (size_t i = 0; i < end; ) {
+            size_t j = i, k;
+            if (pig_is(buf[i], PIG_LETTER)
+                    || (pig_is(buf[i], PIG_HIGH) && (pig_utf8_char(buf + i, end - i, &k) & PIG_LETTER))) {
+                while (j < end && pig_is(buf[j], PIG_LETTER)) { // tokens are short: a vector scan would not pay
+                    j++;
+                }
+                if (j < end && pig_is(buf[j], PIG_HIGH)) {
+                    j += pig_utf8_span_letters(buf + j, end - j);
+                }
+                int kind;
+                size_t n = decode(dict, buf + i, j - i, obuf + o, &kind, scratch, scratch + cap);
+                stats->tokens++;
+                stats->ambiguous += kind == PIG_AMBIGUOUS;
+                stats->unknown += kind == PIG_UNKNOWN;
+                stats->not_pig += kind == PIG_NOT_PIG;
+                if (kind != PIG_DECODED && report != NULL) {
+                    report_token(report, dict, offset + i, kind, buf + i, j - i, obuf + o, n, scratch, scratch + cap);
+                }
+                o += n;
+            } else {
+                while (j < end && !pig_is(buf[j], PIG_LETTER | PIG_HIGH)) {
+                    j++;
+                }
+                if (j < end && pig_is(buf[j], PIG_HIGH)) {
+                    j += pig_utf8_span_nonletters(buf + j, end - j);
+                }
+                memcpy(obuf + o, buf + i, j - i);
+                o += j - i;
+            }
+            i = j;
+        }
+        if (fwrite(obuf, 1, o, out) != o) {
+            perror("Failed to write output");
+            status = -1;
+        }
+        memmove(buf, buf + end, total - end);
+        keep = total - end;
+        offset += end;
+        if (last) {
+            break;
+        }
+    }
+    if (status == 0 && fflush(out) != 0) {
+        perror("Failed to write output");
+        status = -1;
+    }
+    free(buf);
+    free(obuf);
+    free(scratch);
+    return status;
+}
+
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_reverse.c -o pig_reverse.o
+ * Programs using pig_reverse.o must be linked with pig.o, pig_simd.o and pig_utf8.o.
+ *
+*/
@@ -0,0 +1,127 @@
+/**
+* @file pig_reverse.h
+* @brief This header file defines the reverse translator, which turns Pig Latin back into English with a dictionary.
+* Pig Latin loses information: "etway" may be "et" + "way" or "wet" with its "w" moved, and "eetstray" may be
+* "street" or "treest". The decoder lists every English word that pig() would translate into a token, keeps the ones
+* found in a dictionary, and picks the one that comes first in the dictionary's word list; tokens with several or
+* no dictionary words are reported. A dictionary is a flat open-addressing hash table that can be saved to a file
+* once and mapped straight into memory by every later run. Words are UTF-8, with the letters of pig_utf8.h.
+* @author Josh
+*/
+
+#ifndef PIG_REVERSE_H
+#define PIG_REVERSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+* @brief The start of a dictionary, in memory and in its file.
+* It is followed by nslots pairs (hash, word number + 1, 0 for an empty slot), nwords + 1 offsets of the words in
+* the string area, and the string area holding the words in lower case, in the order of the word list.
+* All numbers are in the byte order of the machine that built the dictionary.
+*/
+typedef struct {
+    char magic[8];          /**< PIG_DICT_MAGIC. */
+    uint32_t byte_order;    /**< 0x01020304 written in the byte order of the file. */
+    uint32_t nslots;        /**< Number of slots of the hash table, a power of 2. */
+    uint32_t nwords;        /**< Number of words. */
+    uint32_t strings_size;  /**< Size of the string area in bytes. */
+} PigDictHeader;
+
+/** The first bytes of a saved dictionary. */
+#define PIG_DICT_MAGIC "PIGDICT1"
+
+/**
+* @brief A dictionary, either mapped from a saved file or built in memory from a word list.
+*/
+typedef struct {
+    void *data;                     /**< The whole dictionary, laid out as in its file. */
+    size_t size;                    /**< Size of data in bytes. */
+    int mapped;                     /**< 1 if data is a file mapping, 0 if it was allocated. */
+    const PigDictHeader *header;    /**< The header, at the start of data. */
+    const uint32_t *slots;          /**< The hash table. */
+    const uint32_t *offsets;        /**< Offsets of the words in strings. */
+    const char *strings;            /**< The words. */
+} PigDict;
+
+/** What the decoder made of a token. */
+enum {
+    PIG_DECODED,    /**< Exactly one dictionary word (or, without a dictionary, one English word) fits. */
+    PIG_AMBIGUOUS,  /**< Several dictionary words fit; the first in the word list was chosen. */
+    PIG_UNKNOWN,    /**< English words fit but none is in the dictionary; the first of them was chosen. */
+    PIG_NOT_PIG     /**< No English word translates to the token; it was copied as it is. */
+};
+
+/**
+* @brief Counts of the tokens of a decoded text, by what the decoder made of them.
+*/
+typedef struct {
+    unsigned long long tokens;      /**< Tokens (runs of letters) decoded. */
+    unsigned long long ambiguous;   /**< Tokens that were PIG_AMBIGUOUS. */
+    unsigned long long unknown;     /**< Tokens that were PIG_UNKNOWN. */
+    unsigned long long not_pig;     /**< Tokens that were PIG_NOT_PIG. */
+} PigDecodeStats;
+
+/**
+* @brief Opens a dictionary: a file saved by pig_dict_save is mapped into memory, anything else is read as a word list.
+* A word list is any text; its runs of letters are the words, most frequent first, and case does not matter.
+* @param dict The dictionary to open.
+* @param path The file.
+* @return 0 on success, -1 on failure (a message is printed to stderr).
+*/
+int pig_dict_open(PigDict *dict, const char *path);
+
+/**
+* @brief Saves a dictionary so that pig_dict_open can map it.
+* @param dict The dictionary.
+* @param path The file to write.
+* @return 0 on success, -1 on failure (a message is printed to stderr).
+*/
+int pig_dict_save(const PigDict *dict, const char *path);
+
+/**
+* @brief Unmaps or frees a dictionary.
+* @param dict The dictionary.
+*/
+void pig_dict_close(PigDict *dict);
+
+/**
+* @brief Looks a word up in a dictionary.
+* @param dict The dictionary.
+* @param word The word, in lower case.
+* @param len The number of bytes of word.
+* @return The position of the word in the word list (0 for the first), or -1 if it is not there.
+*/
+long pig_dict_find(const PigDict *dict, const char *word, size_t len);
+
+/**
+* @brief Decodes one Pig Latin word.
+* The capitals are moved back the way pig() moved them, so "Appyhay" gives "Happy", "APPYHAY" gives "HAPPY" and
+* "Andúñay" gives "Ñandú".
+* @param dict The dictionary, or NULL to take the first English word that fits.
+* @param token The Pig Latin word, a run of letters.
+* @param len The number of bytes of token.
+* @param out Receives the English word; it must have room for len bytes and is not NUL-terminated.
+* @param kind Receives PIG_DECODED, PIG_AMBIGUOUS, PIG_UNKNOWN or PIG_NOT_PIG.
+* @return The length of the English word, or -1 if memory could not be allocated (a message is printed to stderr).
+*/
+long pig_decode_word(const PigDict *dict, const char *token, size_t len, char *out, int *kind);
+
+/**
+* @brief Decodes a whole text: runs of letters are decoded as words and everything else is copied.
+* Every token that is not PIG_DECODED gets a line in report: its byte offset in the input, what it was, the token,
+* the word chosen and the words that fit, separated by tabs.
+* @param dict The dictionary, or NULL.
+* @param in The Pig Latin text.
+* @param out Receives the English text.
+* @param report Receives the report, or NULL for none.
+* @param buffer_size The size of the chunks the input is read in.
+* @param stats Receives the counts of the tokens.
+* @return 0 on success, -1 on a read, write or allocation error (a message is printed to stderr).
+*/
+int pig_decode_stream(const PigDict *dict, FILE *in, FILE *out, FILE *report, size_t buffer_size,
+                      PigDecodeStats *stats);
+
+#endif /* PIG_REVERSE_H */
@@ -0,0 +1,378 @@
+/**
+* @file pig_simd.c
+* @brief This file implements the character classification and scans of pig_simd.h with SSE2 and AVX2.
+* A block of bytes is classified with a few vector operations: OR-ing 0x20 maps upper case onto lower case, a shifted
+* signed comparison tests for 'a'..'z' in one go, and comparisons with each vowel build the vowel mask. The mask of
+* the bytes being searched for is moved into an integer and the first one is found by counting trailing zeros.
+* Bytes at the end that do not fill a block are scanned one at a time, so nothing past len is ever read.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#include <stddef.h>
+#include "pig_ctype.h"
+#include "pig_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIG_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/** What a scan stops at. */
+enum { STOP_NONLETTER, STOP_LETTER, STOP_VOWEL, STOP_VOWEL_Y };
+
+/** The pig_ctype flags a scan stops at, and whether it stops where they are missing instead. */
+static const struct { int flags; int invert; } stops[] = {
+    [STOP_NONLETTER] = { PIG_LETTER, 1 },
+    [STOP_LETTER] = { PIG_LETTER, 0 },
+    [STOP_VOWEL] = { PIG_VOWEL, 0 },
+    [STOP_VOWEL_Y] = { PIG_VOWEL_Y, 0 },
+};
+
+/**
+* @brief Checks whether a scan stops at a byte.
+* @param c The byte.
+* @param stop What the scan stops at.
+* @return 1 if the scan stops at c, 0 otherwise.
+*/
+
+static inline int stops_at(char c, int stop) {
+    return (pig_is(c, stops[stop].flags) != 0) != stops[stop].invert;
+}
+
+/**
+* @brief Scans s one byte at a time.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param stop What the scan stops at.
+* @return The index of the first byte the scan stops at, or len.
+*/
+
+static size_t scan_scalar(const char *s, size_t len, int stop) {
+    size_t i = 0;
+    while (i < len && !stops_at(s[i], stop)) {
+        i++;
+    }
+    return i;
+}
+
+/**
+* @brief Classifies up to 64 bytes one at a time.
+*/
+
+static void classify_scalar(const char *s, size_t n, PigMasks *masks) {
+    uint64_t letters = 0, vowels = 0, vowels_y = 0;
+    for (size_t k = 0; k < n; k++) {
+        uint64_t bit = (uint64_t) 1 << k;
+        letters |= pig_is(s[k], PIG_LETTER) ? bit : 0;
+        vowels |= pig_is(s[k], PIG_VOWEL) ? bit : 0;
+        vowels_y |= pig_is(s[k], PIG_VOWEL_Y) ? bit : 0;
+    }
+    masks->letters = letters;
+    masks->vowels = vowels;
+    masks->vowels_y = vowels_y;
+}
+
+#ifdef PIG_SIMD_X86
+
+/**
+* @brief Classifies 64 bytes with SSE2, 16 at a time.
+*/
+__attribute__((target("sse2")))
+static void classify_sse2(const char *s, PigMasks *masks) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i shift = _mm_set1_epi8((char) (0x80 - 'a'));
+    const __m128i limit = _mm_set1_epi8((char) (-128 + 26));
+    uint64_t letters = 0, vowels = 0, vowels_y = 0;
+    for (int k = 0; k < 64; k += 16) {
+        __m128i lower = _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + k)), case_bit);
+        __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(lower, shift), limit);
+        __m128i vowel = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('a')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('e'))),
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('i')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('o'))));
+        vowel = _mm_or_si128(vowel, _mm_cmpeq_epi8(lower, _mm_set1_epi8('u')));
+        __m128i vowel_y = _mm_or_si128(vowel, _mm_cmpeq_epi8(lower, _mm_set1_epi8('y')));
+        letters |= (uint64_t) (unsigned) _mm_movemask_epi8(letter) << k;
+        vowels |= (uint64_t) (unsigned) _mm_movemask_epi8(vowel) << k;
+        vowels_y |= (uint64_t) (unsigned) _mm_movemask_epi8(vowel_y) << k;
+    }
+    masks->letters = letters;
+    masks->vowels = vowels;
+    masks->vowels_y = vowels_y;
+}
+
+/**
+* @brief Classifies 64 bytes with AVX2, 32 at a time.
+*/
+__attribute__((target("avx2")))
+static void classify_avx2(const char *s, PigMasks *masks) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i shift = _mm256_set1_epi8((char) (0x80 - 'a'));
+    const __m256i limit = _mm256_set1_epi8((char) (-128 + 26));
+    uint64_t letters = 0, vowels = 0, vowels_y = 0;
+    for (int k = 0; k < 64; k += 32) {
+        __m256i lower = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (s + k)), case_bit);
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(lower, shift));
+        __m256i vowel = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('a')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('e'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('i')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('o'))));
+        vowel = _mm256_or_si256(vowel, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('u')));
+        __m256i vowel_y = _mm256_or_si256(vowel, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('y')));
+        letters |= (uint64_t) (uint32_t) _mm256_movemask_epi8(letter) << k;
+        vowels |= (uint64_t) (uint32_t) _mm256_movemask_epi8(vowel) << k;
+        vowels_y |= (uint64_t) (uint32_t) _mm256_movemask_epi8(vowel_y) << k;
+    }
+    masks->letters = letters;
+    masks->vowels = vowels;
+    masks->vowels_y = vowels_y;
+}
+
+/**
+* @brief Scans s 16 bytes at a time with SSE2.
+*/
+__attribute__((target("sse2")))
+static size_t scan_sse2(const char *s, size_t len, int stop) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i shift = _mm_set1_epi8((char) (0x80 - 'a'));   // moves 'a' to -128
+    const __m128i limit = _mm_set1_epi8((char) (-128 + 26));     // so 'a'..'z' are the bytes below this
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i lower = _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + i)), case_bit);
+        unsigned mask;
+        if (stop == STOP_NONLETTER || stop == STOP_LETTER) {
+            __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(lower, shift), limit);
+            mask = (unsigned) _mm_movemask_epi8(letter);
+            if (stop == STOP_NONLETTER) {
+                mask ^= 0xFFFF;
+            }
+        } else {
+            __m128i vowel = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('a')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('e'))),
+                _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('i')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('o'))));
+            vowel = _mm_or_si128(vowel, _mm_cmpeq_epi8(lower, _mm_set1_epi8('u')));
+            if (stop == STOP_VOWEL_Y) {
+                vowel = _mm_or_si128(vowel, _mm_cmpeq_epi8(lower, _mm_set1_epi8('y')));
+            }
+            mask = (unsigned) _mm_movemask_epi8(vowel);
+        }
+        if (mask != 0) {
+            return i + (size_t) __builtin_ctz(mask);
+        }
+    }
+    return i + scan_scalar(s + i, len - i, stop);
+}
+
+/**
+* @brief Scans s 32 bytes at a time with AVX2.
+*/
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char *s, size_t len, int stop) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i shift = _mm256_set1_epi8((char) (0x80 - 'a'));
+    const __m256i limit = _mm256_set1_epi8((char) (-128 + 26));
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i lower = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (s + i)), case_bit);
+        unsigned mask;
+        if (stop == STOP_NONLETTER || stop == STOP_LETTER) {
+            __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(lower, shift));
+            mask = (unsigned) _mm256_movemask_epi8(letter);
+            if (stop == STOP_NONLETTER) {
+                mask = ~mask;
+            }
+        } else {
+            __m256i vowel = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('a')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('e'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('i')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('o'))));
+            vowel = _mm256_or_si256(vowel, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('u')));
+            if (stop == STOP_VOWEL_Y) {
+                vowel = _mm256_or_si256(vowel, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('y')));
+            }
+            mask = (unsigned) _mm256_movemask_epi8(vowel);
+        }
+        if (mask != 0) {
+            return i + (size_t) __builtin_ctz(mask);
+        }
+    }
+    return i + scan_sse2(s + i, len - i, stop);
+}
+
+/**
+* @brief Checks 16 bytes at a time with SSE2 whether any byte has its top bit set.
+*/
+__attribute__((target("sse2")))
+static size_t ascii_sse2(const char *s, size_t len) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) { // OR four vectors together so there is one test per 64 bytes
+        __m128i any = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + i)), _mm_loadu_si128((const __m128i *) (s + i + 16))),
+            _mm_or_si128(_mm_loadu_si128((const __m128i *) (s + i + 32)), _mm_loadu_si128((const __m128i *) (s + i + 48))));
+        if (_mm_movemask_epi8(any) != 0) {
+            return SIZE_MAX;
+        }
+    }
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (s + i))) != 0) {
+            return SIZE_MAX;
+        }
+    }
+    return i;
+}
+
+/**
+* @brief Checks 32 bytes at a time with AVX2 whether any byte has its top bit set.
+*/
+__attribute__((target("avx2")))
+static size_t ascii_avx2(const char *s, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i any = _mm256_or_si256(
+            _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (s + i)), _mm256_loadu_si256((const __m256i *) (s + i + 32))),
+            _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (s + i + 64)), _mm256_loadu_si256((const __m256i *) (s + i + 96))));
+        if (_mm256_movemask_epi8(any) != 0) {
+            return SIZE_MAX;
+        }
+    }
+    for (; i + 32 <= len; i += 32) {
+        if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *) (s + i))) != 0) {
+            return SIZE_MAX;
+        }
+    }
+    return i;
+}
+
+#endif /* PIG_SIMD_X86 */
+
+/**
+* @brief Scans s with the fastest instruction set the CPU supports.
+* Runs shorter than a block go straight to the scalar loop.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param stop What the scan stops at.
+* @return The index of the first byte the scan stops at, or len.
+*/
+
+static size_t scan(const char *s, size_t len, int stop) {
+#ifdef PIG_SIMD_X86
+    if (len >= 32 && __builtin_cpu_supports("avx2")) {
+        return scan_avx2(s, len, stop);
+    }
+    if (len >= 16 && __builtin_cpu_supports("sse2")) {
+        return scan_sse2(s, len, stop);
+    }
+#endif
+    return scan_scalar(s, len, stop);
+}
+
+/**
+* @brief Classifies up to 64 bytes into letter and vowel masks.
+* Full blocks use the fastest instruction set the CPU supports.
+* @param s The bytes.
+* @param n The number of bytes, at most 64.
+* @param masks Receives the masks.
+*/
+
+void pig_classify64(const char *s, size_t n, PigMasks *masks) {
+#ifdef PIG_SIMD_X86
+    if (n == 64) {
+        if (__builtin_cpu_supports("avx2")) {
+            classify_avx2(s, masks);
+            return;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            classify_sse2(s, masks);
+            return;
+        }
+    }
+#endif
+    classify_scalar(s, n, masks);
+}
+
+/**
+* @brief Finds the end of the run of letters at the start of s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The index of the first byte that is not a letter, or len.
+*/
+
+size_t pig_span_letters(const char *s, size_t len) {
+    return scan(s, len, STOP_NONLETTER);
+}
+
+/**
+* @brief Finds the first letter in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The index of the first letter, or len.
+*/
+
+size_t pig_span_nonletters(const char *s, size_t len) {
+    return scan(s, len, STOP_LETTER);
+}
+
+/**
+* @brief Finds the first vowel in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param with_y Nonzero to count y and Y as vowels.
+* @return The index of the first vowel, or len.
+*/
+
+size_t pig_find_vowel(const char *s, size_t len, int with_y) {
+    return scan(s, len, with_y ? STOP_VOWEL_Y : STOP_VOWEL);
+}
+
+/**
+* @brief Checks whether a text is plain ASCII.
+* The vector loops return how many bytes they checked, or SIZE_MAX as soon as they find a byte above 0x7F; the
+* bytes that do not fill a vector are checked one at a time.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return 1 if no byte is above 0x7F, 0 otherwise.
+*/
+
+int pig_is_ascii(const char *s, size_t len) {
+    size_t i = 0;
+#ifdef PIG_SIMD_X86
+    if (len >= 32 && __builtin_cpu_supports("avx2")) {
+        i = ascii_avx2(s, len);
+    } else if (len >= 16 && __builtin_cpu_supports("sse2")) {
+        i = ascii_sse2(s, len);
+    }
+    if (i == SIZE_MAX) {
+        return 0;
+    }
+#endif
+    for (; i < len; i++) {
+        if (pig_is(s[i], PIG_HIGH)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+* @brief Returns the name of the instruction set the scans use.
+* @return "avx2", "sse2" or "scalar".
+*/
+
+const char *pig_simd_isa(void) {
+#ifdef PIG_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_simd.c -o pig_simd.o
+ * this file implements pig_classify64, pig_span_letters, pig_span_nonletters, pig_find_vowel, pig_is_ascii and
+ * pig_simd_isa.
+ * Programs using pig_simd.o must be linked with pig.o, which holds the pig_ctype table.
+ */
@@ -0,0 +1,72 @@
+/**
+* @file pig_simd.h
+* @brief This header file defines the vectorised character scans used to split text into words and words into their parts.
+* On x86 the scans classify 16 (SSE2) or 32 (AVX2) bytes at a time into letter and vowel masks and find the first byte
+* of interest with a bit scan; the instruction set is chosen at run time and other processors use plain C loops.
+* Letters are the ASCII letters A-Z and a-z; vowels are a, e, i, o and u in either case, and y if asked for.
+* @author Josh
+*/
+
+#ifndef PIG_SIMD_H
+#define PIG_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* @brief Classification of a block of up to 64 bytes: bit k of each mask describes byte k.
+*/
+typedef struct {
+    uint64_t letters;   /**< Bytes that are letters. */
+    uint64_t vowels;    /**< Bytes that are a, e, i, o or u in either case. */
+    uint64_t vowels_y;  /**< Bytes that are vowels or y in either case. */
+} PigMasks;
+
+/**
+* @brief Classifies up to 64 bytes into letter and vowel masks.
+* @param s The bytes.
+* @param n The number of bytes, at most 64; the mask bits from n up are 0.
+* @param masks Receives the masks.
+*/
+void pig_classify64(const char* s, size_t n, PigMasks* masks);
+
+/**
+* @brief Finds the end of the run of letters at the start of s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The index of the first byte that is not a letter, or len if there is none.
+*/
+size_t pig_span_letters(const char* s, size_t len);
+
+/**
+* @brief Finds the first letter in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The index of the first letter, or len if there is none.
+*/
+size_t pig_span_nonletters(const char* s, size_t len);
+
+/**
+* @brief Finds the first vowel in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param with_y Nonzero to count y and Y as vowels.
+* @return The index of the first vowel, or len if there is none.
+*/
+size_t pig_find_vowel(const char* s, size_t len, int with_y);
+
+/**
+* @brief Checks whether a text is plain ASCII, so that it can take the translators' ASCII-only paths.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return 1 if no byte is above 0x7F, 0 otherwise.
+*/
+int pig_is_ascii(const char* s, size_t len);
+
+/**
+* @brief Returns the name of the instruction set the scans use: "avx2", "sse2" or "scalar".
+* @return The name.
+*/
+const char* pig_simd_isa(void);
+
+#endif /* PIG_SIMD_H */
@@ -0,0 +1,929 @@
+/**
+* @file pig_stream.c
+* @brief This file translates whole texts to Pig Latin at high throughput, for files and pipes of any size.
+* The text is processed in large chunks. Every alphabetic run is translated as a word, as pig() would translate it,
+* and everything else (whitespace, punctuation, digits) is copied through unchanged. The translation is collected
+* in a large output buffer that is written with fwrite when full. A word cut off at the end of one chunk is kept
+* until the next chunk completes it. Files are mapped into memory, so they are translated in a single chunk.
+* The parallel functions cut the text into chunks at word boundaries instead, translate the chunks on a pool of
+* threads and write the translations in their original order, keeping a bounded ring of chunks in memory.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#define _POSIX_C_SOURCE 200809L /* posix_madvise, sysconf */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pig.h"
+#include "pig_ctype.h"
+#include "pig_simd.h"
+#include "pig_stream.h"
+#include "pig_utf8.h"
+
+/**
+* @brief A text being walked a block of 64 bytes at a time, with the letter and vowel masks of the current block.
+* Classifying a whole block at once and finding word boundaries and vowels in its masks with bit scans is much
+* cheaper than a vector scan per word, as most words and the gaps between them are only a few bytes long.
+*/
+typedef struct {
+    const char *text;   /**< The text. */
+    size_t len;         /**< Its length. */
+    size_t block;       /**< Offset of the classified block. */
+    size_t block_len;   /**< Bytes in the classified block (0 before the first). */
+    PigMasks masks;     /**< Masks of the classified block. */
+} Blocks;
+
+/**
+* @brief Makes sure the block holding pos is classified.
+* @param b The text.
+* @param pos An offset below b->len.
+* @return The offset of pos in the block.
+*/
+
+static inline size_t classify_at(Blocks *b, size_t pos) {
+    if (pos - b->block >= b->block_len) {
+        b->block = pos;
+        b->block_len = b->len - pos < 64 ? b->len - pos : 64;
+        pig_classify64(b->text + pos, b->block_len, &b->masks);
+    }
+    return pos - b->block;
+}
+
+/**
+* @brief Finds the end of the word starting at pos and its leading consonant cluster.
+* @param b The text.
+* @param pos The offset of a letter that starts a word.
+* @param cluster Receives the length of the consonant cluster, as pig_cluster would compute it.
+* @return The offset just past the word.
+*/
+
+static size_t word_end(Blocks *b, size_t pos, size_t *cluster) {
+    size_t off = classify_at(b, pos);
+    int vowel_first = (b->masks.vowels >> off) & 1;
+    size_t vowel = SIZE_MAX;
+    size_t i = pos + 1;
+    while (i < b->len) {
+        off = classify_at(b, i);
+        uint64_t stops = ~b->masks.letters >> off; // bits past the end of the text are stops too
+        uint64_t vowels = b->masks.vowels_y >> off;
+        if (vowel == SIZE_MAX && vowels != 0) {
+            vowel = i + (size_t) __builtin_ctzll(vowels);
+        }
+        if (stops != 0) {
+            i += (size_t) __builtin_ctzll(stops);
+            break;
+        }
+        i = b->block + b->block_len;
+    }
+    *cluster = vowel_first ? 0 : (vowel < i ? vowel : i) - pos;
+    return i;
+}
+
+/**
+* @brief Finds the first letter at or after pos.
+* @param b The text.
+* @param pos An offset in the text.
+* @return The offset of the letter, or the length of the text.
+*/
+
+static size_t gap_end(Blocks *b, size_t pos) {
+    while (pos < b->len) {
+        size_t off = classify_at(b, pos);
+        uint64_t letters = b->masks.letters >> off;
+        if (letters != 0) {
+            return pos + (size_t) __builtin_ctzll(letters);
+        }
+        pos = b->block + b->block_len;
+    }
+    return pos;
+}
+
+/**
+* @brief Translates a piece of text into a buffer, stopping before the first word whose translation does not fit.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation.
+* @param cap The size of out.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+
+size_t pig_text(const char *in, size_t len, char *out, size_t cap, size_t *consumed) {
+    return pig_text_cached(NULL, in, len, out, cap, consumed);
+}
+
+/**
+* @brief Translates a piece of plain ASCII text, finding the words and their clusters in the masks of 64-byte blocks.
+* @param cache The cache, or NULL to translate every word.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation.
+* @param cap The size of out.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+
+static size_t text_ascii(PigCache *cache, const char *in, size_t len, char *out, size_t cap, size_t *consumed) {
+    Blocks b = { in, len, 0, 0, { 0, 0, 0 } };
+    size_t i = 0, o = 0;
+    while (i < len) {
+        size_t j;
+        if (pig_is(in[i], PIG_LETTER)) {
+            size_t cluster;
+            j = word_end(&b, i, &cluster);
+            if (cap - o < j - i + 3) { // the translation might not fit
+                break;
+            }
+            o += cache != NULL ? pig_cache_translate(cache, in + i, j - i, out + o)
+                               : pig_emit(in + i, j - i, cluster, out + o);
+        } else {
+            j = gap_end(&b, i + 1);
+            if (j - i > cap - o) {
+                j = i + (cap - o);
+            }
+            if (j == i) {
+                break;
+            }
+            memcpy(out + o, in + i, j - i);
+            o += j - i;
+        }
+        i = j;
+    }
+    *consumed = i;
+    return o;
+}
+
+/**
+* @brief Translates a piece of UTF-8 text a character at a time.
+* Only the gaps between words may be cut when out is full, so a character cut there is copied on the next call.
+* @param cache The cache, or NULL to translate every word.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation.
+* @param cap The size of out.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+
+static size_t text_utf8(PigCache *cache, const char *in, size_t len, char *out, size_t cap, size_t *consumed) {
+    size_t i = 0, o = 0;
+    while (i < len) {
+        size_t j, n;
+        if (pig_utf8_char(in + i, len - i, &n) & PIG_LETTER) {
+            j = i + pig_utf8_span_letters(in + i, len - i);
+            if (cap - o < j - i + 3) {
+                break;
+            }
+            o += cache != NULL ? pig_cache_translate(cache, in + i, j - i, out + o)
+                               : pig_emit(in + i, j - i, pig_utf8_cluster(in + i, j - i), out + o);
+        } else {
+            j = i + n + pig_utf8_span_nonletters(in + i + n, len - i - n);
+            if (j - i > cap - o) {
+                j = i + (cap - o);
+            }
+            if (j == i) {
+                break;
+            }
+            memcpy(out + o, in + i, j - i);
+            o += j - i;
+        }
+        i = j;
+    }
+    *consumed = i;
+    return o;
+}
+
+/**
+* @brief Translates a piece of text into a buffer like pig_text, looking words up in a cache first.
+* A translation is never shorter than its text, so at most cap bytes of it (up to the end of the word they end in)
+* can be translated. If those are plain ASCII, which is checked with vector loads, the words are found in letter and
+* vowel masks; otherwise the text is decoded a character at a time.
+* @param cache The cache, or NULL to translate every word.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation.
+* @param cap The size of out.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+
+size_t pig_text_cached(PigCache *cache, const char *in, size_t len, char *out, size_t cap, size_t *consumed) {
+    size_t limit = len < cap ? len : cap;
+    while (limit < len && pig_is(in[limit], PIG_LETTER)) {
+        limit++;
+    }
+    if ((limit == len || !pig_is(in[limit], PIG_HIGH)) && pig_is_ascii(in, limit)) {
+        return text_ascii(cache, in, limit, out, cap, consumed);
+    }
+    return text_utf8(cache, in, len, out, cap, consumed);
+}
+
+/**
+* @brief Translates a line as the interactive program does: every word followed by one space.
+* @param cache The cache, or NULL to translate every word.
+* @param line The line.
+* @param len The number of bytes of the line.
+* @param out The buffer that receives the translation, of at least PIG_LINE_MAX(len) bytes.
+* @return The number of bytes written to out, or -1 if the line holds anything but letters and whitespace.
+*/
+
+long pig_line(PigCache *cache, const char *line, size_t len, char *out) {
+    for (size_t i = 0, n; i < len; i += n) {
+        if (!(pig_utf8_char(line + i, len - i, &n) & (PIG_LETTER | PIG_SPACE))) {
+            return -1;
+        }
+    }
+    size_t o = 0;
+    size_t start = pig_utf8_span_nonletters(line, len);
+    while (start < len) {
+        size_t end = start + pig_utf8_span_letters(line + start, len - start);
+        o += cache != NULL ? pig_cache_translate(cache, line + start, end - start, out + o)
+                           : pig_emit(line + start, end - start, pig_cluster(line + start, end - start), out + o);
+        out[o++] = ' ';
+        start = end + pig_utf8_span_nonletters(line + end, len - end);
+    }
+    return (long) o;
+}
+
+/**
+* @brief Writes the output buffer of a stream to its file.
+* @param ps The stream.
+*/
+
+static void flush_output(PigStream *ps) {
+    if (ps->out_len > 0 && fwrite(ps->out, 1, ps->out_len, ps->fp) != ps->out_len) {
+        ps->error = 1;
+    }
+    ps->out_len = 0;
+}
+
+/**
+* @brief Translates one complete word into the output of a stream.
+* Words too long for the output buffer are translated into a buffer of their own and written straight to the file.
+* @param ps The stream.
+* @param word The word.
+* @param len The number of letters in the word.
+*/
+
+static void emit_stream_word(PigStream *ps, const char *word, size_t len) {
+    if (ps->out_cap - ps->out_len < len + 3) {
+        flush_output(ps);
+    }
+    if (ps->out_cap < len + 3) {
+        char *translation = malloc(len + 3);
+        if (translation == NULL) {
+            fprintf(stderr, "Error: Memory allocation failed.\n");
+            ps->error = 1;
+            return;
+        }
+        size_t n = pig_emit(word, len, pig_cluster(word, len), translation);
+        if (fwrite(translation, 1, n, ps->fp) != n) {
+            ps->error = 1;
+        }
+        free(translation);
+        return;
+    }
+    ps->out_len += ps->cache != NULL ? pig_cache_translate(ps->cache, word, len, ps->out + ps->out_len)
+                                     : pig_emit(word, len, pig_cluster(word, len), ps->out + ps->out_len);
+}
+
+/**
+* @brief Appends letters to the pending word of a stream.
+* @param ps The stream.
+* @param letters The letters.
+* @param len The number of letters.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+static int append_word(PigStream *ps, const char *letters, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (ps->word_len + len > ps->word_cap) {
+        size_t cap = ps->word_cap * 2 > ps->word_len + len ? ps->word_cap * 2 : ps->word_len + len;
+        char *word = realloc(ps->word, cap);
+        if (word == NULL) {
+            fprintf(stderr, "Error: Memory allocation failed.\n");
+            ps->error = 1;
+            return -1;
+        }
+        ps->word = word;
+        ps->word_cap = cap;
+    }
+    memcpy(ps->word + ps->word_len, letters, len);
+    ps->word_len += len;
+    return 0;
+}
+
+/**
+* @brief Starts a streaming translation to fp.
+* @param ps The stream to initialise.
+* @param fp Where the translation is written.
+* @param buffer_size The size of the output buffer in bytes.
+* @return 0 on success, -1 if the buffer could not be allocated.
+*/
+
+int pig_stream_init(PigStream *ps, FILE *fp, size_t buffer_size) {
+    memset(ps, 0, sizeof(*ps));
+    ps->fp = fp;
+    ps->out_cap = buffer_size < 64 ? 64 : buffer_size;
+    ps->out = malloc(ps->out_cap);
+    if (ps->out == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+* @brief Translates a complete piece of text into the output of a stream.
+* @param ps The stream.
+* @param text The text, which does not end inside a word.
+* @param len The number of bytes of text.
+*/
+
+static void emit_stream_text(PigStream *ps, const char *text, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        if (ps->out_len == ps->out_cap) {
+            flush_output(ps);
+        }
+        size_t used;
+        ps->out_len += pig_text_cached(ps->cache, text + pos, len - pos, ps->out + ps->out_len, ps->out_cap - ps->out_len, &used);
+        pos += used;
+        if (used == 0) { // the next word does not fit in what is left of the buffer
+            size_t j = pos + pig_utf8_span_letters(text + pos, len - pos);
+            emit_stream_word(ps, text + pos, j - pos);
+            pos = j;
+        }
+    }
+}
+
+/**
+* @brief Translates the next chunk of a text.
+* The letters at the end of the chunk, and a UTF-8 sequence cut off by its end, are held back, as the word may
+* continue in the next chunk; the rest is translated with pig_text_cached straight into the output buffer.
+* @param ps The stream.
+* @param data The chunk.
+* @param len The number of bytes in the chunk.
+* @return 0 on success, -1 if writing or allocating failed.
+*/
+
+int pig_stream_write(PigStream *ps, const char *data, size_t len) {
+    if (ps->error) {
+        return -1;
+    }
+    if (ps->word_len > 0) { // finish the word left over from the last chunk
+        size_t k = 0;
+        while (k < len && k < 3 && ((unsigned char) data[k] & 0xC0) == 0x80) {
+            k++; // the rest of a sequence that was cut off
+        }
+        k += pig_utf8_span_letters(data + k, len - k);
+        if (k < len && pig_utf8_word_start(data, len) <= k) {
+            k = len; // the letters stop at a sequence cut off by the end of this chunk
+        }
+        if (append_word(ps, data, k) != 0) {
+            return -1;
+        }
+        if (k == len) {
+            return 0;
+        }
+        emit_stream_text(ps, ps->word, ps->word_len);
+        ps->word_len = 0;
+        data += k;
+        len -= k;
+    }
+
+    size_t end = pig_utf8_word_start(data, len);
+    emit_stream_text(ps, data, end);
+    if (append_word(ps, data + end, len - end) != 0) {
+        return -1;
+    }
+    return ps->error ? -1 : 0;
+}
+
+/**
+* @brief Translates the last word of the text and flushes the output buffer.
+* @param ps The stream.
+* @return 0 on success, -1 if any write of the stream failed.
+*/
+
+int pig_stream_finish(PigStream *ps) {
+    if (ps->word_len > 0) {
+        emit_stream_text(ps, ps->word, ps->word_len);
+        ps->word_len = 0;
+    }
+    flush_output(ps);
+    if (fflush(ps->fp) != 0) {
+        ps->error = 1;
+    }
+    return ps->error ? -1 : 0;
+}
+
+/**
+* @brief Frees the buffers of a stream.
+* @param ps The stream.
+*/
+
+void pig_stream_free(PigStream *ps) {
+    free(ps->out);
+    free(ps->word);
+    ps->out = NULL;
+    ps->word = NULL;
+}
+
+/**
+* @brief Translates everything read from in to out in chunks of buffer_size bytes.
+* @param in The input.
+* @param out The output.
+* @param buffer_size The size of the input chunks and of the output buffer.
+* @param cache The cache the words are looked up in, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_translate_stream(FILE *in, FILE *out, size_t buffer_size, PigCache *cache) {
+    PigStream ps;
+    if (pig_stream_init(&ps, out, buffer_size) != 0) {
+        return -1;
+    }
+    ps.cache = cache;
+    char *chunk = malloc(ps.out_cap);
+    if (chunk == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        pig_stream_free(&ps);
+        return -1;
+    }
+    int status = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, ps.out_cap, in)) > 0) {
+        if (pig_stream_write(&ps, chunk, n) != 0) {
+            break;
+        }
+    }
+    if (ferror(in)) {
+        perror("Failed to read input");
+        status = -1;
+    }
+    if (pig_stream_finish(&ps) != 0) {
+        perror("Failed to write output");
+        status = -1;
+    }
+    free(chunk);
+    pig_stream_free(&ps);
+    return status;
+}
+
+/**
+* @brief Opens a file and maps it into memory if it is a non-empty regular file.
+* @param path The file to open.
+* @param fd Receives the open file descriptor.
+* @param map Receives the mapping, or MAP_FAILED if the file has to be read instead.
+* @param size Receives the size of the mapping.
+* @return 0 on success, -1 if the file could not be opened (a message is printed to stderr).
+*/
+
+static int open_mapped(const char *path, int *fd, void **map, size_t *size) {
+    struct stat st;
+    *map = MAP_FAILED;
+    *size = 0;
+    *fd = open(path, O_RDONLY);
+    if (*fd < 0 || fstat(*fd, &st) != 0) {
+        perror(path);
+        if (*fd >= 0) {
+            close(*fd);
+        }
+        return -1;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) { // pipes, devices and empty files are read in chunks instead
+        *size = (size_t) st.st_size;
+        *map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, *fd, 0);
+        if (*map != MAP_FAILED) {
+            posix_madvise(*map, *size, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+    return 0;
+}
+
+/**
+* @brief Translates a file that could not be mapped by reading it through stdio.
+* @param path The name of the file, for error messages.
+* @param fd The open file; it is closed.
+* @param out The output.
+* @param buffer_size The size of the chunks.
+* @param threads The number of threads, or -1 to use pig_translate_stream.
+* @param cache The cache the words are looked up in, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+static int translate_unmapped(const char *path, int fd, FILE *out, size_t buffer_size, int threads, PigCache *cache) {
+    FILE *in = fdopen(fd, "rb");
+    if (in == NULL) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    int status = threads < 0 ? pig_translate_stream(in, out, buffer_size, cache)
+                             : pig_translate_stream_parallel(in, out, buffer_size, threads, cache);
+    fclose(in);
+    return status;
+}
+
+/**
+* @brief Translates a file to out, mapping it into memory when it is a regular file.
+* @param path The file to translate.
+* @param out The output.
+* @param buffer_size The size of the output buffer.
+* @param cache The cache the words are looked up in, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_translate_file(const char *path, FILE *out, size_t buffer_size, PigCache *cache) {
+    int fd;
+    void *map;
+    size_t size;
+    if (open_mapped(path, &fd, &map, &size) != 0) {
+        return -1;
+    }
+    if (map == MAP_FAILED) {
+        return translate_unmapped(path, fd, out, buffer_size, -1, cache);
+    }
+
+    int status = 0;
+    PigStream ps;
+    if (pig_stream_init(&ps, out, buffer_size) != 0) {
+        status = -1;
+    } else {
+        ps.cache = cache;
+        pig_stream_write(&ps, map, size);
+        if (pig_stream_finish(&ps) != 0) {
+            perror("Failed to write output");
+            status = -1;
+        }
+        pig_stream_free(&ps);
+    }
+    munmap(map, size);
+    close(fd);
+    return status;
+}
+
+/** Chunks per thread in the parallel pipeline: while every thread translates one, the next ones are read and written. */
+#define CHUNKS_PER_THREAD 2
+
+/** States of a chunk of the parallel pipeline. */
+enum { CHUNK_FREE, CHUNK_FILLED, CHUNK_DONE };
+
+/**
+* @brief One chunk of the parallel pipeline: a piece of text that starts and ends at word boundaries, and its translation.
+*/
+typedef struct {
+    const char *in;     /**< The text, in buf or in the mapped file. */
+    size_t in_len;      /**< Length of the text. */
+    char *buf;          /**< Input buffer when reading through stdio. */
+    size_t buf_cap;     /**< Size of buf. */
+    char *out;          /**< The translation. */
+    size_t out_len;     /**< Length of the translation. */
+    size_t out_cap;     /**< Size of out, at least PIG_TEXT_MAX(in_len). */
+    int state;          /**< CHUNK_FREE, CHUNK_FILLED or CHUNK_DONE. */
+} Chunk;
+
+/**
+* @brief Where the chunks of the parallel pipeline come from: a mapped file or a stdio stream.
+*/
+typedef struct {
+    const char *map;    /**< The mapped file, or NULL to read fp. */
+    size_t map_len;     /**< Size of the mapped file. */
+    size_t map_pos;     /**< Start of the next chunk in the mapped file. */
+    FILE *fp;           /**< The stream read when map is NULL. */
+    size_t chunk_size;  /**< Target size of the chunks. */
+    char *carry;        /**< Letters read after the end of the last chunk, which start the next one. */
+    size_t carry_len;   /**< Number of letters in carry. */
+    size_t carry_cap;   /**< Size of carry. */
+} ChunkSource;
+
+/**
+* @brief The ring of chunks shared by the reading and writing thread and the translating threads.
+* Chunk k lives in chunks[k % nchunks]; it is read once chunk k - nchunks has been written.
+*/
+typedef struct {
+    Chunk *chunks;          /**< The ring of chunks. */
+    int nchunks;            /**< Number of chunks in the ring. */
+    long produced;          /**< Number of chunks filled so far. */
+    long next;              /**< Number of the next chunk to translate. */
+    int eof;                /**< Set when no more chunks will be filled. */
+    pthread_mutex_t lock;   /**< Protects the fields above and the chunk states. */
+    pthread_cond_t filled;  /**< Signalled when a chunk is filled or eof is set. */
+    pthread_cond_t done;    /**< Signalled when a chunk has been translated. */
+    PigCache *cache;        /**< Cache each worker starts a copy of, and whose counters it adds to; or NULL. */
+} Pipeline;
+
+/**
+* @brief Makes sure a buffer holds at least need bytes.
+* @param buf The buffer, which may be reallocated.
+* @param cap The size of the buffer, which is updated.
+* @param need The required size.
+* @return 0 on success, -1 if memory could not be allocated.
+*/
+
+static int reserve(char **buf, size_t *cap, size_t need) {
+    if (*cap >= need) {
+        return 0;
+    }
+    size_t new_cap = *cap * 2 > need ? *cap * 2 : need;
+    char *grown = realloc(*buf, new_cap);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return -1;
+    }
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+/**
+* @brief Fills a chunk with the next piece of text, ending at a word boundary.
+* A chunk is about chunk_size bytes; it is cut before the letters at its end (which are carried over to the next chunk),
+* and grows only if it consists of a single word.
+* @param src The source of the text.
+* @param c The chunk to fill.
+* @return 1 if the chunk holds text, 0 at the end of the input, -1 on a read or allocation error.
+*/
+
+static int fill_chunk(ChunkSource *src, Chunk *c) {
+    if (src->map != NULL) {
+        size_t pos = src->map_pos;
+        if (pos == src->map_len) {
+            return 0;
+        }
+        size_t end = src->map_len - pos > src->chunk_size ? pos + src->chunk_size : src->map_len;
+        if (end < src->map_len && pig_is(src->map[end], PIG_LETTER | PIG_HIGH)) {
+            end = pos + pig_utf8_word_start(src->map + pos, end - pos); // move the cut back to the start of the word
+        }
+        if (end == pos) {
+            end = pos + src->chunk_size; // the chunk is a single word: take all of it
+            while (end < src->map_len && ((unsigned char) src->map[end] & 0xC0) == 0x80) {
+                end++;
+            }
+            end += pig_utf8_span_letters(src->map + end, src->map_len - end);
+        }
+        c->in = src->map + pos;
+        c->in_len = end - pos;
+        src->map_pos = end;
+        return 1;
+    }
+
+    if (reserve(&c->buf, &c->buf_cap, src->carry_len + src->chunk_size) != 0) {
+        return -1;
+    }
+    if (src->carry_len > 0) {
+        memcpy(c->buf, src->carry, src->carry_len);
+    }
+    size_t n = src->carry_len;
+    src->carry_len = 0;
+    for (;;) {
+        n += fread(c->buf + n, 1, c->buf_cap - n, src->fp);
+        if (n < c->buf_cap) { // end of input (or a read error)
+            if (ferror(src->fp)) {
+                perror("Failed to read input");
+                return -1;
+            }
+            break;
+        }
+        size_t end = pig_utf8_word_start(c->buf, n);
+        if (end == n) {
+            break;
+        }
+        if (end > 0) {
+            if (reserve(&src->carry, &src->carry_cap, n - end) != 0) {
+                return -1;
+            }
+            memcpy(src->carry, c->buf + end, n - end);
+            src->carry_len = n - end;
+            n = end;
+            break;
+        }
+        if (reserve(&c->buf, &c->buf_cap, c->buf_cap * 2) != 0) { // a single word fills the chunk
+            return -1;
+        }
+    }
+    c->in = c->buf;
+    c->in_len = n;
+    return n > 0;
+}
+
+/**
+* @brief Translates chunks in the order they were filled until there are no more.
+* @param arg Pointer to the Pipeline.
+* @return NULL.
+*/
+
+static void *translate_worker(void *arg) {
+    Pipeline *p = arg;
+    PigCache cache;
+    PigCache *own = NULL;
+    if (p->cache != NULL && pig_cache_clone(&cache, p->cache) == 0) { // without memory, translate without a cache
+        own = &cache;
+    }
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->next == p->produced && !p->eof) {
+            pthread_cond_wait(&p->filled, &p->lock);
+        }
+        if (p->next == p->produced) {
+            break;
+        }
+        Chunk *c = &p->chunks[p->next++ % p->nchunks];
+        pthread_mutex_unlock(&p->lock);
+
+        size_t used;
+        c->out_len = pig_text_cached(own, c->in, c->in_len, c->out, c->out_cap, &used); // out_cap fits the whole chunk
+
+        pthread_mutex_lock(&p->lock);
+        c->state = CHUNK_DONE;
+        pthread_cond_broadcast(&p->done);
+    }
+    if (own != NULL) {
+        p->cache->hits += own->hits;
+        p->cache->misses += own->misses;
+        p->cache->full += own->full;
+        if (own->used > p->cache->used) { // report the fullest copy
+            p->cache->used = own->used;
+        }
+        pig_cache_free(own);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/**
+* @brief Waits until a chunk has been translated and writes its translation.
+* @param p The pipeline.
+* @param c The chunk.
+* @param out The output.
+* @return 0 on success, -1 if the write failed.
+*/
+
+static int write_chunk(Pipeline *p, Chunk *c, FILE *out) {
+    pthread_mutex_lock(&p->lock);
+    while (c->state != CHUNK_DONE) {
+        pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    c->state = CHUNK_FREE;
+    return fwrite(c->out, 1, c->out_len, out) == c->out_len ? 0 : -1;
+}
+
+/**
+* @brief Runs the parallel pipeline: the calling thread fills chunks and writes the translations in order,
+* while the worker threads translate them.
+* @param src The source of the text.
+* @param out The output.
+* @param threads The number of translating threads, or 0 for one per online CPU.
+* @param cache The cache each thread starts a copy of, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+static int run_pipeline(ChunkSource *src, FILE *out, int threads, PigCache *cache) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    if (src->chunk_size < 64) {
+        src->chunk_size = 64;
+    }
+    Pipeline p;
+    p.nchunks = CHUNKS_PER_THREAD * threads;
+    p.chunks = calloc(p.nchunks, sizeof(Chunk));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    if (p.chunks == NULL || tids == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        free(p.chunks);
+        free(tids);
+        return -1;
+    }
+    p.produced = 0;
+    p.next = 0;
+    p.eof = 0;
+    p.cache = cache;
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.filled, NULL);
+    pthread_cond_init(&p.done, NULL);
+    int started = 0;
+    while (started < threads && pthread_create(&tids[started], NULL, translate_worker, &p) == 0) {
+        started++;
+    }
+
+    int status = started > 0 ? 0 : -1;
+    long written = 0;
+    for (long seq = 0; status == 0; seq++) {
+        Chunk *c = &p.chunks[seq % p.nchunks];
+        if (seq >= p.nchunks) { // chunk seq - nchunks leaves the ring
+            written++;
+            if (write_chunk(&p, c, out) != 0) {
+                perror("Failed to write output");
+                status = -1;
+                break;
+            }
+        }
+        int filled = fill_chunk(src, c);
+        if (filled > 0 && reserve(&c->out, &c->out_cap, PIG_TEXT_MAX(c->in_len)) != 0) {
+            filled = -1;
+        }
+        if (filled <= 0) {
+            status = filled;
+            break;
+        }
+        pthread_mutex_lock(&p.lock);
+        c->state = CHUNK_FILLED;
+        p.produced++;
+        pthread_cond_signal(&p.filled);
+        pthread_mutex_unlock(&p.lock);
+    }
+
+    pthread_mutex_lock(&p.lock);
+    p.eof = 1;
+    pthread_cond_broadcast(&p.filled);
+    pthread_mutex_unlock(&p.lock);
+    // write the chunks still in the ring, in order
+    for (long k = written; k < p.produced; k++) {
+        if (write_chunk(&p, &p.chunks[k % p.nchunks], out) != 0 && status == 0) {
+            perror("Failed to write output");
+            status = -1;
+        }
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    if (fflush(out) != 0 && status == 0) {
+        perror("Failed to write output");
+        status = -1;
+    }
+
+    for (int k = 0; k < p.nchunks; k++) {
+        free(p.chunks[k].buf);
+        free(p.chunks[k].out);
+    }
+    free(p.chunks);
+    free(tids);
+    free(src->carry);
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.filled);
+    pthread_cond_destroy(&p.done);
+    return status;
+}
+
+/**
+* @brief Translates everything read from in to out on several threads.
+* @param in The input.
+* @param out The output.
+* @param chunk_size The size of the chunks in bytes.
+* @param threads The number of translating threads, or 0 for one per online CPU.
+* @param cache The cache each thread starts a copy of, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_translate_stream_parallel(FILE *in, FILE *out, size_t chunk_size, int threads, PigCache *cache) {
+    ChunkSource src = {NULL, 0, 0, in, chunk_size, NULL, 0, 0};
+    return run_pipeline(&src, out, threads, cache);
+}
+
+/**
+* @brief Translates a file to out on several threads, mapping it into memory when it is a regular file.
+* @param path The file to translate.
+* @param out The output.
+* @param chunk_size The size of the chunks in bytes.
+* @param threads The number of translating threads, or 0 for one per online CPU.
+* @param cache The cache each thread starts a copy of, or NULL.
+* @return 0 on success, -1 on failure.
+*/
+
+int pig_translate_file_parallel(const char *path, FILE *out, size_t chunk_size, int threads, PigCache *cache) {
+    int fd;
+    void *map;
+    size_t size;
+    if (open_mapped(path, &fd, &map, &size) != 0) {
+        return -1;
+    }
+    if (map == MAP_FAILED) {
+        return translate_unmapped(path, fd, out, chunk_size, threads < 0 ? 0 : threads, cache);
+    }
+    ChunkSource src = {map, size, 0, NULL, chunk_size, NULL, 0, 0};
+    int status = run_pipeline(&src, out, threads, cache);
+    munmap(map, size);
+    close(fd);
+    return status;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_stream.c -o pig_stream.o
+ * Programs using pig_stream.o must be linked with pig.o, pig_simd.o, pig_utf8.o, pig_cache.o and -pthread.
+ */
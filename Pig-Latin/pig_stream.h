@@ -0,0 +1,152 @@
+/**
+* @file pig_stream.h
+* @brief This header file defines the functions that translate whole texts, files and pipes to Pig Latin.
+* A word is a maximal run of letters: A-Z, a-z and the accented Latin letters of UTF-8 text (see pig_utf8.h);
+* everything between words (spaces, punctuation, digits, newlines, other characters) is copied verbatim. Programs
+* using these functions must be linked with pig.o, pig_simd.o, pig_utf8.o, pig_cache.o and -pthread.
+* @author Josh
+*/
+
+#ifndef PIG_STREAM_H
+#define PIG_STREAM_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "pig_cache.h"
+
+/** An upper bound on the translation of len bytes of text: every word grows by at most 3 and words are at least 2 bytes apart. */
+#define PIG_TEXT_MAX(len) ((len) + 3 * (((len) + 1) / 2))
+
+/** An upper bound on the translation of a line of len bytes by pig_line: every word grows by at most 4. */
+#define PIG_LINE_MAX(len) ((len) + 4 * (((len) + 1) / 2))
+
+/**
+* @brief State of a streaming translation: the output buffer and a word that may continue in the next chunk.
+*/
+typedef struct {
+    FILE *fp;           /**< Where the translation is written. */
+    char *out;          /**< Output buffer, flushed with fwrite when full. */
+    size_t out_len;     /**< Bytes in out. */
+    size_t out_cap;     /**< Size of out. */
+    char *word;         /**< Letters at the end of the last chunk, waiting for the rest of their word. */
+    size_t word_len;    /**< Number of bytes in word. */
+    size_t word_cap;    /**< Size of word. */
+    int error;          /**< Set once a write or allocation has failed. */
+    PigCache *cache;    /**< Cache the words are looked up in, or NULL (the default) to translate every word. */
+} PigStream;
+
+/**
+* @brief Translates a piece of text into a buffer, stopping before the first word whose translation does not fit.
+* Words are never split: a word that runs to the end of in is translated as a complete word, and one whose
+* translation does not fit in the remaining space is left for the next call. Text between words is copied as far
+* as it fits.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation; it is not NUL-terminated.
+* @param cap The size of out; a cap of PIG_TEXT_MAX(len) always takes the whole text.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+size_t pig_text(const char *in, size_t len, char *out, size_t cap, size_t *consumed);
+
+/**
+* @brief Translates a piece of text into a buffer like pig_text, looking the words up in a cache first.
+* @param cache The cache, or NULL to translate every word.
+* @param in The text.
+* @param len The number of bytes of text.
+* @param out The buffer that receives the translation; it is not NUL-terminated.
+* @param cap The size of out.
+* @param consumed Receives the number of bytes of in that were translated.
+* @return The number of bytes written to out.
+*/
+size_t pig_text_cached(PigCache *cache, const char *in, size_t len, char *out, size_t cap, size_t *consumed);
+
+/**
+* @brief Translates a line as the interactive program does: every word followed by one space.
+* The line may hold only letters (accented UTF-8 letters included) and whitespace; the whitespace itself is dropped.
+* @param cache The cache, or NULL to translate every word.
+* @param line The line; it need not be NUL-terminated.
+* @param len The number of bytes of the line.
+* @param out The buffer that receives the translation, of at least PIG_LINE_MAX(len) bytes; it is not NUL-terminated.
+* @return The number of bytes written to out, or -1 if the line holds anything but letters and whitespace.
+*/
+long pig_line(PigCache *cache, const char *line, size_t len, char *out);
+
+/**
+* @brief Starts a streaming translation to fp.
+* @param ps The stream to initialise.
+* @param fp Where the translation is written.
+* @param buffer_size The size of the output buffer in bytes (at least 64 is used).
+* @return 0 on success, -1 if the buffer could not be allocated.
+*/
+int pig_stream_init(PigStream *ps, FILE *fp, size_t buffer_size);
+
+/**
+* @brief Translates the next chunk of a text. Chunks may end in the middle of a word.
+* @param ps The stream.
+* @param data The chunk.
+* @param len The number of bytes in the chunk.
+* @return 0 on success, -1 if writing or allocating failed.
+*/
+int pig_stream_write(PigStream *ps, const char *data, size_t len);
+
+/**
+* @brief Translates the last word of the text and flushes the output buffer.
+* @param ps The stream.
+* @return 0 on success, -1 if any write of the stream failed.
+*/
+int pig_stream_finish(PigStream *ps);
+
+/**
+* @brief Frees the buffers of a stream.
+* @param ps The stream.
+*/
+void pig_stream_free(PigStream *ps);
+
+/**
+* @brief Translates everything read from in to out, reading chunks of buffer_size bytes.
+* @param in The input.
+* @param out The output.
+* @param buffer_size The size of the input chunks and of the output buffer.
+* @param cache The cache the words are looked up in, or NULL to translate every word.
+* @return 0 on success, -1 on a read, write or allocation error (a message is printed to stderr).
+*/
+int pig_translate_stream(FILE *in, FILE *out, size_t buffer_size, PigCache *cache);
+
+/**
+* @brief Translates a file to out, mapping it into memory where possible and reading it in chunks otherwise.
+* @param path The file to translate.
+* @param out The output.
+* @param buffer_size The size of the output buffer (and of the input chunks if the file cannot be mapped).
+* @param cache The cache the words are looked up in, or NULL to translate every word.
+* @return 0 on success, -1 on failure (a message is printed to stderr).
+*/
+int pig_translate_file(const char *path, FILE *out, size_t buffer_size, PigCache *cache);
+
+/**
+* @brief Translates everything read from in to out on several threads.
+* The input is cut into chunks of about chunk_size bytes at word boundaries, the chunks are translated in parallel,
+* and their translations are written in the original order, so the output is the same as pig_translate_stream's.
+* At most 2 * threads chunks are in memory at once (a chunk only grows beyond chunk_size to hold a longer word).
+* @param in The input.
+* @param out The output.
+* @param chunk_size The size of the chunks in bytes.
+* @param threads The number of translating threads, or 0 for one per online CPU.
+* @param cache A cache each thread starts a copy of, and whose hit counters receive theirs; or NULL.
+* @return 0 on success, -1 on failure (a message is printed to stderr).
+*/
+int pig_translate_stream_parallel(FILE *in, FILE *out, size_t chunk_size, int threads, PigCache *cache);
+
+/**
+* @brief Translates a file to out on several threads, mapping it into memory where possible.
+* Like pig_translate_stream_parallel, but the chunks of a mapped file are translated where they lie, without copying.
+* @param path The file to translate.
+* @param out The output.
+* @param chunk_size The size of the chunks in bytes.
+* @param threads The number of translating threads, or 0 for one per online CPU.
+* @param cache A cache each thread starts a copy of, and whose hit counters receive theirs; or NULL.
+* @return 0 on success, -1 on failure (a message is printed to stderr).
+*/
+int pig_translate_file_parallel(const char *path, FILE *out, size_t chunk_size, int threads, PigCache *cache);
+
+#endif /* PIG_STREAM_H */
@@ -0,0 +1,310 @@
+/**
+* @file pig_utf8.c
+* @brief This file implements the UTF-8 character functions of pig_utf8.h.
+* All the letters beyond ASCII are code points below U+0180, so they are two-byte sequences: a character is decoded
+* only far enough to tell its length, and the two-byte ones are classified by their code point. Case is changed only
+* between letters of the same length, so a translation never changes size when its capitals are moved.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "pig_ctype.h"
+#include "pig_utf8.h"
+
+/** Flags of a vowel. */
+#define V (PIG_VOWEL | PIG_VOWEL_Y)
+
+/**
+* @brief Checks whether a code point of Latin Extended-A is a capital.
+* Most of the block is pairs of a capital and its small letter; the pairs start on an even code point, except in
+* U+0139..U+0148 and U+0179..U+017E, where they start on an odd one.
+* @param cp A code point from U+0100 to U+017F.
+* @return 1 if cp is a capital, 0 otherwise.
+*/
+
+static int extended_upper(unsigned cp) {
+    if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+        return cp & 1;
+    }
+    if (cp == 0x138 || cp == 0x149 || cp == 0x17F) { // kra, 'n and long s have no capital
+        return 0;
+    }
+    return cp == 0x178 || !(cp & 1);
+}
+
+/**
+* @brief Classifies a code point from U+0080 to U+07FF.
+* @param cp The code point.
+* @return Its pig_ctype flags.
+*/
+
+static int latin_flags(unsigned cp) {
+    if (cp < 0xC0 || cp > 0x17F || cp == 0xD7 || cp == 0xF7) {
+        return 0;
+    }
+    int flags = PIG_LETTER;
+    unsigned lower = cp;
+    if (cp < 0x100) {
+        if (cp < 0xDF) {
+            flags |= PIG_UPPER;
+            lower = cp + 0x20;
+        }
+        if ((lower >= 0xE0 && lower <= 0xE6) || (lower >= 0xE8 && lower <= 0xEF)
+                || (lower >= 0xF2 && lower <= 0xF6) || (lower >= 0xF8 && lower <= 0xFC)) {
+            flags |= V;
+        } else if (lower == 0xFD || lower == 0xFF) { // y with acute and diaeresis
+            flags |= PIG_VOWEL_Y;
+        }
+        return flags;
+    }
+    if (extended_upper(cp)) {
+        flags |= PIG_UPPER;
+    }
+    if (cp <= 0x105 || (cp >= 0x112 && cp <= 0x11B) || (cp >= 0x128 && cp <= 0x131)
+            || (cp >= 0x14C && cp <= 0x153) || (cp >= 0x168 && cp <= 0x173)) {
+        flags |= V;
+    } else if (cp >= 0x176 && cp <= 0x178) { // y with circumflex and diaeresis
+        flags |= PIG_VOWEL_Y;
+    }
+    return flags;
+}
+
+/**
+* @brief Changes the case of a code point, if the other case has a code point of the same UTF-8 length.
+* @param cp The code point.
+* @param upper Nonzero for the capital, zero for the small letter.
+* @return The code point in the other case, or cp.
+*/
+
+static unsigned change_case(unsigned cp, int upper) {
+    int flags = cp < 0x80 ? pig_ctype[cp] : latin_flags(cp);
+    if (!(flags & PIG_LETTER) || (flags & PIG_UPPER) == (upper ? PIG_UPPER : 0)) {
+        return cp;
+    }
+    if (cp < 0x80 || (cp < 0xFF && cp != 0xDF)) {
+        return cp ^ 0x20; // ASCII and Latin-1 pair up 0x20 apart
+    }
+    if (cp == 0xFF || cp == 0x178) { // y with diaeresis has its capital in Extended-A
+        return upper ? 0x178 : 0xFF;
+    }
+    if (cp < 0x100 || cp == 0x130 || cp == 0x131 || cp == 0x138 || cp == 0x149 || cp == 0x17F) {
+        return cp; // sharp s, dotted and dotless i and the letters without a capital
+    }
+    return upper ? cp - 1 : cp + 1;
+}
+
+/**
+* @brief Finds the length of the UTF-8 sequence a byte starts.
+* @param c The byte.
+* @return 1 to 4, or 0 if c cannot start a sequence.
+*/
+
+static size_t sequence_length(unsigned char c) {
+    if (c < 0x80) {
+        return 1;
+    }
+    if (c < 0xC2) { // continuation bytes and the overlong C0 and C1
+        return 0;
+    }
+    if (c < 0xE0) {
+        return 2;
+    }
+    if (c < 0xF0) {
+        return 3;
+    }
+    return c < 0xF5 ? 4 : 0;
+}
+
+/**
+* @brief Classifies the character at the start of s.
+* @param s The text; len must be at least 1.
+* @param len The number of bytes of text.
+* @param n Receives the number of bytes of the character.
+* @return Its pig_ctype flags, 0 for characters that are not letters and for bytes that do not start a valid sequence.
+*/
+
+int pig_utf8_char(const char *s, size_t len, size_t *n) {
+    unsigned char c = (unsigned char) s[0];
+    size_t need = sequence_length(c);
+    *n = 1;
+    if (need == 1) {
+        return pig_ctype[c];
+    }
+    if (need == 0 || need > len) {
+        return 0;
+    }
+    for (size_t k = 1; k < need; k++) {
+        if (((unsigned char) s[k] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    *n = need;
+    return need == 2 ? latin_flags(((unsigned) (c & 0x1F) << 6) | ((unsigned char) s[1] & 0x3F)) : 0;
+}
+
+/**
+* @brief Finds the end of the run of letters at the start of s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The number of bytes of the letters.
+*/
+
+size_t pig_utf8_span_letters(const char *s, size_t len) {
+    size_t i = 0, n;
+    while (i < len && (pig_utf8_char(s + i, len - i, &n) & PIG_LETTER)) {
+        i += n;
+    }
+    return i;
+}
+
+/**
+* @brief Finds the first letter in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The offset of the first letter, or len.
+*/
+
+size_t pig_utf8_span_nonletters(const char *s, size_t len) {
+    size_t i = 0, n;
+    while (i < len && !(pig_utf8_char(s + i, len - i, &n) & PIG_LETTER)) {
+        i += n;
+    }
+    return i;
+}
+
+/**
+* @brief Finds where the letters at the end of a text begin, counting a sequence cut off at the end as a letter.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The offset of the first of the letters at the end, or len.
+*/
+
+size_t pig_utf8_word_start(const char *s, size_t len) {
+    size_t start = len;
+    size_t lead = len;
+    while (lead > 0 && len - lead < 3 && ((unsigned char) s[lead - 1] & 0xC0) == 0x80) {
+        lead--;
+    }
+    if (lead > 0 && sequence_length((unsigned char) s[lead - 1]) > len - lead + 1) {
+        start = lead - 1; // the last sequence is cut off
+    }
+    while (start > 0) {
+        size_t n;
+        if (!((unsigned char) s[start - 1] & 0x80)) {
+            if (!pig_is(s[start - 1], PIG_LETTER)) {
+                break;
+            }
+            start--;
+        } else if (start >= 2 && (pig_utf8_char(s + start - 2, 2, &n) & PIG_LETTER) && n == 2) {
+            start -= 2; // the letters beyond ASCII are all two bytes long
+        } else {
+            break;
+        }
+    }
+    return start;
+}
+
+/**
+* @brief Finds the leading consonant cluster of a word, in whole code points.
+* @param word The word.
+* @param len The number of bytes of the word.
+* @return The number of bytes of the consonant cluster.
+*/
+
+size_t pig_utf8_cluster(const char *word, size_t len) {
+    size_t n;
+    if (len == 0 || (pig_utf8_char(word, len, &n) & PIG_VOWEL)) {
+        return 0;
+    }
+    size_t i = n;
+    while (i < len && !(pig_utf8_char(word + i, len - i, &n) & PIG_VOWEL_Y)) {
+        i += n;
+    }
+    return i;
+}
+
+/**
+* @brief Writes a letter of the word into a translation in the other case, as far as it lies in the first n bytes.
+* The letter is taken from the word, so a translation cut off in the middle of it still gets its first bytes right.
+* @param out The translation.
+* @param n The number of bytes of the translation present in out.
+* @param at The offset of the letter in out.
+* @param letter The letter in the word.
+* @param len The number of bytes of the word from letter on.
+* @param upper Nonzero for a capital, zero for a small letter.
+*/
+
+static void set_case(char *out, size_t n, size_t at, const char *letter, size_t len, int upper) {
+    size_t k;
+    if (at >= n || !(pig_utf8_char(letter, len, &k) & PIG_LETTER)) {
+        return;
+    }
+    char c[2];
+    if (k == 1) {
+        c[0] = (char) change_case((unsigned char) letter[0], upper);
+    } else {
+        unsigned cp = change_case(((unsigned) (letter[0] & 0x1F) << 6) | (letter[1] & 0x3F), upper);
+        c[0] = (char) (0xC0 | (cp >> 6));
+        c[1] = (char) (0x80 | (cp & 0x3F));
+    }
+    memcpy(out + at, c, k < n - at ? k : n - at);
+}
+
+/**
+* @brief Writes a text in lower case.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param out Receives the text in lower case, len bytes; it may be s itself.
+*/
+
+void pig_utf8_lower(const char *s, size_t len, char *out) {
+    for (size_t i = 0, k; i < len; i += k) {
+        if (!((unsigned char) s[i] & 0x80)) {
+            out[i] = pig_is(s[i], PIG_UPPER) ? s[i] | 0x20 : s[i];
+            k = 1;
+        } else if (pig_utf8_char(s + i, len - i, &k) & PIG_UPPER) {
+            set_case(out, len, i, s + i, len - i, 0);
+        } else if (out != s) {
+            memcpy(out + i, s + i, k);
+        }
+    }
+}
+
+/**
+* @brief Moves the capitals of a translation written by rotating a word to where they belong.
+* @param out The translation.
+* @param n The number of bytes of the translation present in out.
+* @param word The word.
+* @param len The number of bytes of the word.
+* @param cluster The number of bytes of its consonant cluster.
+*/
+
+void pig_utf8_fix_case(char *out, size_t n, const char *word, size_t len, size_t cluster) {
+    size_t k;
+    if (len == 0 || !(pig_utf8_char(word, len, &k) & PIG_UPPER)) {
+        return;
+    }
+    size_t first = k, i = k;
+    while (i < len && (pig_utf8_char(word + i, len - i, &k) & PIG_UPPER)) {
+        i += k;
+    }
+    if (i == len && len > first) { // at least two letters, all capitals: "ÉTÉ" -> "ÉTÉWAY"
+        for (size_t j = len; j < n; j++) {
+            out[j] &= ~0x20;
+        }
+    } else if (cluster > 0 && cluster < len) { // a capitalised word: "Ñandú" -> "Andúñay"
+        set_case(out, n, 0, word + cluster, len - cluster, 1);
+        set_case(out, n, len - cluster, word, len, 0);
+    }
+}
+
+#undef V
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c pig_utf8.c -o pig_utf8.o
+ * Programs using pig_utf8.o must be linked with pig.o, which holds the pig_ctype table.
+ */
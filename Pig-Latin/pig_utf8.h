@@ -0,0 +1,78 @@
+/**
+* @file pig_utf8.h
+* @brief This header file defines the UTF-8 character functions that let the translator handle accented words.
+* Besides A-Z and a-z, the letters of Latin-1 (U+00C0 to U+00FF, except the signs U+00D7 and U+00F7) and of Latin
+* Extended-A (U+0100 to U+017F) are letters, so "café", "Ñandú" and "žena" are words. Their accented a, e, i, o, u
+* (and æ, ø, œ) are vowels, and ý, ÿ, ŷ and Ÿ count like y. Words are cut and moved in whole code points only.
+* Validation is relaxed: any other character, and any byte that is not part of a valid UTF-8 sequence, is simply not
+* a letter, and is copied through as it is.
+* @author Josh
+*/
+
+#ifndef PIG_UTF8_H
+#define PIG_UTF8_H
+
+#include <stddef.h>
+
+/**
+* @brief Classifies the character at the start of s.
+* @param s The text; len must be at least 1.
+* @param len The number of bytes of text.
+* @param n Receives the number of bytes of the character: its UTF-8 sequence, or 1 for a byte that does not start one.
+* @return The pig_ctype flags of the character: PIG_LETTER, PIG_UPPER, PIG_VOWEL and PIG_VOWEL_Y (0 if not a letter).
+*/
+int pig_utf8_char(const char *s, size_t len, size_t *n);
+
+/**
+* @brief Finds the end of the run of letters at the start of s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The number of bytes of the letters.
+*/
+size_t pig_utf8_span_letters(const char *s, size_t len);
+
+/**
+* @brief Finds the first letter in s.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The offset of the first letter, or len.
+*/
+size_t pig_utf8_span_nonletters(const char *s, size_t len);
+
+/**
+* @brief Finds where the letters at the end of a text begin, so that a text cut into pieces is never cut inside a word.
+* A UTF-8 sequence that is cut off at the end of the text counts as a letter, as it may be the start of one.
+* @param s The text.
+* @param len The number of bytes of text.
+* @return The offset of the first of the letters at the end, or len if the text does not end in a letter.
+*/
+size_t pig_utf8_word_start(const char *s, size_t len);
+
+/**
+* @brief Finds the leading consonant cluster of a word, in whole code points; like pig_cluster for ASCII words.
+* @param word The word.
+* @param len The number of bytes of the word.
+* @return The number of bytes of the consonant cluster.
+*/
+size_t pig_utf8_cluster(const char *word, size_t len);
+
+/**
+* @brief Writes a text in lower case, letter by letter; a letter keeps its length, so the text does not change size.
+* @param s The text.
+* @param len The number of bytes of text.
+* @param out Receives the text in lower case, len bytes; it may be s itself.
+*/
+void pig_utf8_lower(const char *s, size_t len, char *out);
+
+/**
+* @brief Moves the capitals of a translation, written by rotating a word that is not plain ASCII, to where they belong.
+* Follows the rules of pig() for capitalised words and words in capitals, with accented capitals as well.
+* @param out The translation.
+* @param n The number of bytes of the translation present in out.
+* @param word The word.
+* @param len The number of bytes of the word.
+* @param cluster The number of bytes of its consonant cluster.
+*/
+void pig_utf8_fix_case(char *out, size_t n, const char *word, size_t len, size_t cluster);
+
+#endif /* PIG_UTF8_H */
@@ -4,6 +4,10 @@
 * This program repeatedly asks the user for a line of English text and prints the corresponding Pig Latin translation.
 * This program uses a function pig from pig.c file which return the translated Pig latin word.
 * The program stops when the user inputs an empty line.
+* Given -s or file names, it instead translates the whole input non-interactively with pig_stream.c, keeping
+* punctuation, digits and whitespace as they are, which is meant for large files and pipes.
+* With -c, translations of frequent words are kept in a cache (pig_cache.c), optionally filled from a word list with -w,
+* and its hit rate is printed to stderr at the end.
 *
 * @author Josh <id>
 * @bug No known bugs.
@@ -12,30 +16,30 @@
 /* -- Includes -- */
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
 #include "pig.h"
+#include "pig_cache.h"
+#include "pig_stream.h"
 
 /**
 * @brief This function repeatedly asks the user for a line of English text and prints the corresponding Pig Latin translation.
 * The program stops when the user inputs an empty line.
+* @param cache The cache the words are looked up in, or NULL.
 * @return Void.
 */
 
-void piglatin() {
+void piglatin(PigCache *cache) {
     char line[1000];
     while (1) {
         printf("Enter a line of English text (empty line to exit): ");
-        fgets(line, sizeof(line), stdin);
-        // check input validity
-        int valid = 1;
-        for (int i = 0; line[i] != '\0'; i++) {
-            if (!isalpha(line[i]) && !isspace(line[i]) && line[i] != '\n') {
-                valid = 0;
-                break;
-            }
+        if (fgets(line, sizeof(line), stdin) == NULL) { // end of input
+            break;
         }
-        if (!valid) {
+        // pig_line checks the input is valid: UTF-8 letters, accented ones included, and whitespace
+        size_t len = strlen(line);
+        char translation[PIG_LINE_MAX(sizeof(line))];
+        long n = pig_line(cache, line, len, translation);
+        if (n < 0) {
             printf("Invalid input! Input should only contain alphabets, spaces, and new line.\n");
             continue;
         }
@@ -43,32 +47,103 @@ void piglatin() {
         if (line[0] == '\n') {
             break;
         }
-        char *word = strtok(line, " \t\n");
-        while (word != NULL) {
-            char *translation = pig(word);
-            printf("%s ", translation);
-            free(translation);
-            word = strtok(NULL, " \t\n");
-        }
+        fwrite(translation, 1, (size_t) n, stdout);
         printf("\n");
     }
 }
 
 /**
-* @brief Main function to call piglatin function.
+* @brief Main function to call piglatin function, or to translate standard input or files as a stream.
+* @param argc The number of command line arguments
+* @param argv An array of strings containing the command line arguments
 * @return int The exit status of the program.
 */
 
-int main() {
-    piglatin();
-    return 0;
+int main(int argc, char *argv[]) {
+    size_t buffer_size = 1 << 20;
+    int stream = 0;
+    int files = 0;
+    int threads = 1;
+    size_t cache_slots = 0;
+    const char *word_list = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            buffer_size = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_slots = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            word_list = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Usage: %s [-s] [-b buffer_bytes] [-j threads] [-c slots [-w word_list]] [file ...]\n", argv[0]);
+            fprintf(stderr, "  without arguments, translates lines typed interactively\n");
+            fprintf(stderr, "  -s translates standard input to standard output; files (or - for standard input) are translated in turn\n");
+            fprintf(stderr, "  -j translates chunks of buffer_bytes on that many threads (0 for one per CPU); the output is the same\n");
+            fprintf(stderr, "  -c caches the translations of up to that many words (64 bytes each), filled first from word_list\n");
+            return 1;
+        } else {
+            files++;
+        }
+    }
+    PigCache storage;
+    PigCache *cache = NULL;
+    if (cache_slots > 0) {
+        if (pig_cache_init(&storage, cache_slots) != 0) {
+            return 1;
+        }
+        cache = &storage;
+        if (word_list != NULL && pig_cache_load(cache, word_list) < 0) {
+            pig_cache_free(cache);
+            return 1;
+        }
+    }
+    if (!stream && files == 0) {
+        piglatin(cache);
+        if (cache != NULL) {
+            pig_cache_print_stats(cache, stderr);
+            pig_cache_free(cache);
+        }
+        return 0;
+    }
+
+    int status = 0;
+    if (files == 0) {
+        status = threads == 1 ? pig_translate_stream(stdin, stdout, buffer_size, cache)
+                              : pig_translate_stream_parallel(stdin, stdout, buffer_size, threads, cache);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "-c") == 0
+                || strcmp(argv[i], "-w") == 0) {
+            i++;
+        } else if (strcmp(argv[i], "-") == 0) {
+            status |= threads == 1 ? pig_translate_stream(stdin, stdout, buffer_size, cache)
+                                   : pig_translate_stream_parallel(stdin, stdout, buffer_size, threads, cache);
+        } else if (argv[i][0] != '-') {
+            status |= threads == 1 ? pig_translate_file(argv[i], stdout, buffer_size, cache)
+                                   : pig_translate_file_parallel(argv[i], stdout, buffer_size, threads, cache);
+        }
+    }
+    if (cache != NULL) {
+        pig_cache_print_stats(cache, stderr);
+        pig_cache_free(cache);
+    }
+    return status == 0 ? 0 : 1;
 }
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
- * gcc -o piglatin piglatin.c pig.c
+ * gcc -o piglatin piglatin.c pig.c pig_cache.c pig_simd.c pig_stream.c pig_utf8.c -pthread
  * 
  * To run the program, type the following command:
  * ./piglatin
  * 
+ * or, to translate a file or a pipe:
+ * ./piglatin book.txt > book.pig
+ * cat book.txt | ./piglatin -s > book.pig
+ * ./piglatin -j 0 corpus.txt > corpus.pig
+ * ./piglatin -c 4096 -w common_words.txt corpus.txt > corpus.pig
+ * 
  * The program will ask you to input lines of English text, and it will output the corresponding Pig Latin translations. To exit the program, input an empty line. */
\ No newline at end of file
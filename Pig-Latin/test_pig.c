@@ -1,34 +1,36 @@
 /**
 * @file main.c
 * @brief This program tests the pig function by translating a list of English words to Pig Latin.
-* This program creates an array of English words and passes each word to the pig function to translate to Pig Latin. 
-* The translated words are then printed to the console.
+* This program creates an array of English words and translates them all to Pig Latin with one call to pig_batch,
+* which writes every translation into a single buffer. The translated words are then printed to the console.
 * @author Josh
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "pig_batch.h"
 
 /**
 * @brief Main function that tests the pig function by translating a list of English words to Pig Latin.
 *
-* This function creates an array of English words and passes each word to the pig function to translate to Pig Latin. The translated words are then printed to the console.
+* This function creates an array of English words and translates them with pig_batch, which makes one allocation for all of the translations. The translated words are then printed to the console.
 *
 * @return int The exit status of the program.
 */
 
-char *pig(char *word);
-
 int main() {
-    char *words[] = {"happy", "duck", "glove", "evil", "eight", "yowler", "crystal"};
+    const char *words[] = {"happy", "duck", "glove", "evil", "eight", "yowler", "crystal"};
     int len = sizeof(words)/sizeof(words[0]);
 
+    PigBatch batch;
+    if (pig_batch(words, len, &batch) != 0) {
+        return 1;
+    }
     for (int i = 0; i < len; i++) {
-        char *piglatin = pig(words[i]);
-        printf("%s => %s\n", words[i], piglatin);
-        free(piglatin); // Free dynamically allocated memory
+        printf("%s => %s\n", words[i], pig_batch_word(&batch, i));
     }
+    pig_batch_free(&batch); // Free the translations, which are all in one allocation
 
     return 0;
 }
@@ -36,7 +38,7 @@ int main() {
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
- * gcc -o test_pig test_pig.c pig.c
+ * gcc -o test_pig test_pig.c pig.c pig_batch.c pig_simd.c pig_utf8.c
  * 
  * To run the program, type the following command:
  * ./test_pig
@@ -0,0 +1,145 @@
+/**
+* @file unpig.c
+* @brief This program translates Pig Latin back to English.
+* It reads Pig Latin text from files or standard input and writes the English text to standard output, copying
+* everything that is not a word. Words are decoded with pig_reverse.c, using a dictionary to choose between the
+* English words a Pig Latin word may have come from. Words that are ambiguous, not in the dictionary or not Pig Latin
+* at all are listed on standard error (or in a report file), and their counts are printed at the end.
+*
+* @author Josh
+* @bug No known bugs.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pig_reverse.h"
+
+/**
+* @brief Prints how to use the program.
+* @param name The name of the program.
+*/
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-d dictionary] [-o saved_dictionary] [-r report | -q] [-b buffer_bytes] [file ...]\n", name);
+    fprintf(stderr, "  -d a word list (most frequent words first) or a dictionary saved with -o\n");
+    fprintf(stderr, "  -o saves the dictionary given with -d for fast loading, and exits\n");
+    fprintf(stderr, "  -r writes the ambiguous and unknown words to report instead of standard error; -q drops them\n");
+    fprintf(stderr, "  without files (or with -), standard input is decoded\n");
+}
+
+/**
+* @brief Main function: decodes the files named on the command line, or standard input.
+* @param argc The number of command line arguments
+* @param argv An array of strings containing the command line arguments
+* @return int The exit status of the program.
+*/
+
+int main(int argc, char *argv[]) {
+    const char *dict_path = NULL, *save_path = NULL, *report_path = NULL;
+    size_t buffer_size = 1 << 20;
+    int quiet = 0;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            dict_path = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            report_path = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            buffer_size = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files++;
+        }
+    }
+
+    PigDict dict;
+    PigDict *d = NULL;
+    if (dict_path != NULL) {
+        if (pig_dict_open(&dict, dict_path) != 0) {
+            return 1;
+        }
+        d = &dict;
+    }
+    if (save_path != NULL) {
+        if (d == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        int status = pig_dict_save(d, save_path);
+        if (status == 0) {
+            fprintf(stderr, "%u words saved to %s\n", d->header->nwords, save_path);
+        }
+        pig_dict_close(d);
+        return status == 0 ? 0 : 1;
+    }
+
+    FILE *report = quiet ? NULL : stderr;
+    if (report_path != NULL && !quiet) {
+        report = fopen(report_path, "w");
+        if (report == NULL) {
+            perror(report_path);
+            return 1;
+        }
+    }
+
+    PigDecodeStats total = {0, 0, 0, 0}, stats;
+    int status = 0;
+    for (int i = 1; i < argc || files == 0; i++) {
+        FILE *in = stdin;
+        if (files > 0) {
+            if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "-r") == 0
+                    || strcmp(argv[i], "-b") == 0) {
+                i++;
+                continue;
+            }
+            if (argv[i][0] == '-' && argv[i][1] != '\0') {
+                continue;
+            }
+            if (strcmp(argv[i], "-") != 0 && (in = fopen(argv[i], "rb")) == NULL) {
+                perror(argv[i]);
+                status = -1;
+                continue;
+            }
+        }
+        status |= pig_decode_stream(d, in, stdout, report, buffer_size, &stats);
+        total.tokens += stats.tokens;
+        total.ambiguous += stats.ambiguous;
+        total.unknown += stats.unknown;
+        total.not_pig += stats.not_pig;
+        if (in != stdin) {
+            fclose(in);
+        }
+        if (files == 0) {
+            break;
+        }
+    }
+
+    fprintf(stderr, "%llu words: %llu ambiguous, %llu not in the dictionary, %llu not Pig Latin\n",
+            total.tokens, total.ambiguous, total.unknown, total.not_pig);
+    if (report != NULL && report != stderr) {
+        fclose(report);
+    }
+    if (d != NULL) {
+        pig_dict_close(d);
+    }
+    return status == 0 ? 0 : 1;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -o unpig unpig.c pig_reverse.c pig.c pig_simd.c pig_utf8.c
+ *
+ * To run the program, type the following command:
+ * ./piglatin book.txt | ./unpig -d words.txt > book.txt.back
+ *
+ * or, to load a large word list once and map it in every later run:
+ * ./unpig -d words.txt -o words.dict
+ * ./unpig -d words.dict -r ambiguous.tsv book.pig > book.txt
+ */
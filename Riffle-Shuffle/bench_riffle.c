@@ -0,0 +1,320 @@
+/**
+ * @file bench_riffle.c
+ * @brief Microbenchmarks for the hot functions of the riffle library.
+ *
+ * Each benchmark is run for enough iterations to take at least the minimum time, and that
+ * measurement is repeated several times; the median run is reported as nanoseconds per element,
+ * bytes per second and heap allocations per iteration. On Linux the process can be pinned to one
+ * CPU, and allocations are counted by wrapping malloc and calloc at link time (see the Makefile).
+ */
+
+#define _GNU_SOURCE /* sched_setaffinity */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "perm_stats.h"
+#include "riffle.h"
+
+#ifdef BENCH_COUNT_ALLOCS
+static long alloc_count = 0; /**< Number of malloc and calloc calls so far. */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+
+/**
+ * @brief Counts a malloc call and forwards it to the real malloc.
+ *
+ * @param size Number of bytes to allocate.
+ * @return The allocated memory.
+ */
+void *__wrap_malloc(size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+/**
+ * @brief Counts a calloc call and forwards it to the real calloc.
+ *
+ * @param n Number of elements.
+ * @param size Size of each element.
+ * @return The allocated memory.
+ */
+void *__wrap_calloc(size_t n, size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_calloc(n, size);
+}
+#define ALLOCS() __atomic_load_n(&alloc_count, __ATOMIC_RELAXED)
+#else
+#define ALLOCS() 0L
+#endif
+
+/**
+ * @brief State shared by a benchmark's setup and body.
+ */
+typedef struct {
+    size_t len;      /**< Number of elements. */
+    size_t size;     /**< Size of each element in bytes. */
+    char *data;      /**< The array being shuffled or measured. */
+    char *copy;      /**< A second array of the same size. */
+    char *work;      /**< Workspace for riffle_once_r. */
+    Rng rng;         /**< Generator used by the body. */
+    int threads;     /**< Worker threads for average_quality_stats. */
+} Bench;
+
+/**
+ * @brief A benchmark: a body run once per iteration, and how many bytes one iteration touches.
+ */
+typedef struct {
+    const char *name;                      /**< Name printed in the report. */
+    int int_only;                          /**< 1 if the body only works on int elements. */
+    void (*body)(Bench *b);                /**< One iteration. */
+    double passes;                         /**< Passes over len * size bytes per iteration, for bytes/s. */
+    void (*setup)(Bench *b);               /**< Prepares the arrays before calibration, or NULL. */
+} BenchCase;
+
+static volatile double sink; /**< Keeps results alive so the compiler cannot drop the work. */
+
+/**
+ * @brief Compares two elements by the int key stored in their first bytes.
+ *
+ * @param a Pointer to the first element.
+ * @param b Pointer to the second element.
+ * @return -1, 0 or 1.
+ */
+static int cmp_key(const void *a, const void *b) {
+    int x, y;
+    memcpy(&x, a, sizeof(int));
+    memcpy(&y, b, sizeof(int));
+    return (x > y) - (x < y);
+}
+
+static void body_riffle_once(Bench *b) { riffle_once_r(b->data, b->len, b->size, b->work, &b->rng); }
+static void body_riffle(Bench *b) { riffle_r(b->data, b->len, b->size, 7, &b->rng); }
+static void body_riffle_indexed(Bench *b) { riffle_indexed_r(b->data, b->len, b->size, 7, &b->rng); }
+static void body_fisher_yates(Bench *b) { shuffle_fisher_yates.shuffle(b->data, b->len, b->size, 1, &b->rng); }
+static void body_merge(Bench *b) { shuffle_merge.shuffle(b->data, b->len, b->size, 1, &b->rng); }
+static void body_merge_parallel(Bench *b) { shuffle_merge_parallel.shuffle(b->data, b->len, b->size, 1, &b->rng); }
+static void body_overhand(Bench *b) { shuffle_overhand.shuffle(b->data, b->len, b->size, 7, &b->rng); }
+static void body_check(Bench *b) { sink = check_permutation(b->copy, b->data, b->len, b->size, cmp_key); }
+static void body_check_shuffle(Bench *b) { sink = check_shuffle_r(b->data, b->len, b->size, cmp_key, &b->rng); }
+static void body_quality(Bench *b) { sink = quality((int *) b->data, (int) b->len); }
+static void body_displacement(Bench *b) { sink = (double) perm_displacement((const int *) b->data, b->len); }
+static void body_riffle_ascents(Bench *b) {
+    sink = riffle_into_ascents((const int *) b->data, (int *) b->work, b->len, &b->rng);
+}
+static void body_average_quality(Bench *b) {
+    sink = average_quality_stats((int) b->len, 7, 4, b->threads, rng_next(&b->rng), NULL).mean;
+}
+
+/**
+ * @brief Shuffles data, so check_permutation compares a permutation with the sorted copy instead of
+ * sorting two arrays that are already in order.
+ *
+ * @param b The benchmark state.
+ */
+static void setup_shuffled(Bench *b) { riffle_r(b->data, b->len, b->size, 7, &b->rng); }
+
+static const BenchCase cases[] = {
+    {"riffle_once", 0, body_riffle_once, 2, NULL},
+    {"riffle/7", 0, body_riffle, 14, NULL},
+    {"riffle_indexed/7", 0, body_riffle_indexed, 1, NULL},
+    {"fisher_yates", 0, body_fisher_yates, 2, NULL},
+    {"merge", 0, body_merge, 1, NULL},
+    {"merge_parallel", 0, body_merge_parallel, 1, NULL},
+    {"overhand/7", 0, body_overhand, 14, NULL},
+    {"check_permutation", 0, body_check, 2, setup_shuffled},
+    {"check_shuffle", 0, body_check_shuffle, 4, NULL},
+    {"quality", 1, body_quality, 1, NULL},
+    {"perm_displacement", 1, body_displacement, 1, NULL},
+    {"riffle_into_ascents", 1, body_riffle_ascents, 2, NULL},
+    {"average_quality/7x4", 1, body_average_quality, 4 * 7 * 2, NULL},
+};
+
+/**
+ * @brief Returns the time of a monotonic clock in seconds.
+ *
+ * @return The time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Compares two doubles, for qsort.
+ *
+ * @param a Pointer to the first double.
+ * @param b Pointer to the second double.
+ * @return -1, 0 or 1.
+ */
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Runs one benchmark case for one array shape and prints its report line.
+ *
+ * @param c The benchmark.
+ * @param len Number of elements.
+ * @param size Size of each element.
+ * @param repetitions Number of measured runs; the median is reported.
+ * @param min_time Minimum duration of one run in seconds.
+ * @param threads Worker threads for average_quality_stats.
+ */
+static void run_case(const BenchCase *c, size_t len, size_t size, int repetitions, double min_time, int threads) {
+    Bench b;
+    b.len = len;
+    b.size = size;
+    b.threads = threads;
+    b.data = malloc(len * size);
+    b.copy = malloc(len * size);
+    b.work = malloc(len * size);
+    double *runs = malloc(repetitions * sizeof(double));
+    if (b.data == NULL || b.copy == NULL || b.work == NULL || runs == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(b.data, 0, len * size);
+    for (size_t i = 0; i < len; i++) {
+        int key = (int) i;
+        memcpy(b.data + i * size, &key, sizeof(int)); // every element starts with a distinct key
+    }
+    memcpy(b.copy, b.data, len * size);
+    rng_seed(&b.rng, 12345);
+    if (c->setup != NULL) {
+        c->setup(&b);
+    }
+
+    // Calibrate: double the iterations until one run takes at least min_time
+    long iterations = 1;
+    for (;;) {
+        double started = now_seconds();
+        for (long i = 0; i < iterations; i++) {
+            c->body(&b);
+        }
+        if (now_seconds() - started >= min_time || iterations >= (1L << 30)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    long allocs_before = ALLOCS();
+    for (int r = 0; r < repetitions; r++) {
+        double started = now_seconds();
+        for (long i = 0; i < iterations; i++) {
+            c->body(&b);
+        }
+        runs[r] = (now_seconds() - started) / iterations;
+    }
+    double allocs = (double) (ALLOCS() - allocs_before) / ((double) iterations * repetitions);
+
+    qsort(runs, repetitions, sizeof(double), cmp_double);
+    double median = runs[repetitions / 2];
+    double spread = runs[repetitions - 1] - runs[0];
+    char label[64];
+    snprintf(label, sizeof(label), "%s/%zu/%zu", c->name, len, size);
+    printf("%-34s %12.3f %10.1f%% %12.1f %12.2f %10ld\n", label, median * 1e9 / len,
+           100.0 * spread / median, c->passes * len * size / median / 1e6, allocs, iterations);
+
+    free(runs);
+    free(b.data);
+    free(b.copy);
+    free(b.work);
+}
+
+/**
+ * @brief Pins the process to one CPU, where the platform supports it.
+ *
+ * @param cpu The CPU to run on.
+ */
+static void pin_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_setaffinity");
+    }
+#else
+    (void) cpu;
+    fprintf(stderr, "CPU pinning is not supported on this platform\n");
+#endif
+}
+
+/**
+ * @brief Main function for the benchmark program.
+ *
+ * @param argc The number of command line arguments
+ * @param argv An array of strings containing the command line arguments
+ * @return 0 on success, non-zero on failure.
+ */
+int main(int argc, char *argv[]) {
+    int repetitions = 5;
+    double min_time = 0.05;
+    int threads = 1;
+    const char *filter = NULL;
+    size_t lens[] = {1000, 100000, 1000000};
+    size_t sizes[] = {4, 8, 64, 256};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            pin_cpu(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            const char *isa = argv[++i];
+            perm_stats_limit(strcmp(isa, "scalar") == 0 ? PERM_ISA_SCALAR
+                             : strcmp(isa, "sse2") == 0 ? PERM_ISA_SSE2 : PERM_ISA_AVX2);
+        } else {
+            printf("Usage: bench_riffle [-r repetitions] [-t min_seconds_per_run] [-c cpu] [-j threads] [-f name_filter] [-i scalar|sse2|avx2]\n");
+            return 1;
+        }
+    }
+    if (repetitions < 1) {
+        repetitions = 1;
+    }
+
+    printf("perm_stats: %s\n", perm_isa_name(perm_stats_isa()));
+    printf("%-34s %12s %11s %12s %12s %10s\n", "Benchmark/len/size", "ns/element", "spread", "MB/s", "allocs/iter", "iterations");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        if (filter != NULL && strstr(cases[c].name, filter) == NULL) {
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+                if (cases[c].int_only && sizes[s] != sizeof(int)) {
+                    continue;
+                }
+                run_case(&cases[c], lens[l], sizes[s], repetitions, min_time, threads);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Instructions for running the program:
+ * To compile and run the benchmarks, run the following command in the terminal:
+ * make bench
+ *
+ * or, to pass options:
+ * make bench_riffle
+ * ./bench_riffle -c 0 -r 9 -f riffle
+ * ./bench_riffle -i scalar -f quality
+ *
+ * ns/element is the median over the repetitions; spread is (slowest - fastest) / median.
+ */
@@ -9,6 +9,25 @@
 #include <time.h>
 #include "riffle.h"
 
+/**
+ * @brief A record large enough that moving it costs far more than moving its index.
+ */
+typedef struct {
+    int id;             /**< Record number. */
+    char payload[252];  /**< Data carried along with the record. */
+} Record;
+
+/**
+ * @brief Compares two records by id.
+ *
+ * @param a Pointer to the first record.
+ * @param b Pointer to the second record.
+ * @return -1, 0 or 1 as the first id is less than, equal to or greater than the second.
+ */
+static int cmp_record(const void *a, const void *b) {
+    return cmp_int(&((const Record *) a)->id, &((const Record *) b)->id);
+}
+
 /**
  * @brief Main function for the demo program.
  *
@@ -20,10 +39,12 @@ int main() {
     // Shuffle an array of integers
     int arr_int[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
     int arr_int_len = sizeof(arr_int) / sizeof(int);
+    int orig_int[sizeof(arr_int) / sizeof(int)];
+    memcpy(orig_int, arr_int, sizeof(arr_int)); // Keep the original order to verify against
     riffle(arr_int, arr_int_len, sizeof(int), 5);
 
     // Check that shuffled integer array contains all original elements
-    int check_int = check_shuffle(arr_int, arr_int_len, sizeof(int), cmp_int);
+    int check_int = check_permutation(orig_int, arr_int, arr_int_len, sizeof(int), cmp_int);
     printf("Check shuffled integer array: %s\n\n", check_int ? "PASS" : "FAIL");
 
     // Print shuffled integer array
@@ -37,10 +58,12 @@ int main() {
     // Shuffle an array of Greek letter names
     char *greek[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta", "iota", "kappa", "lambda", "mu"};
     int greek_len = sizeof(greek) / sizeof(char *);
+    char *orig_greek[sizeof(greek) / sizeof(char *)];
+    memcpy(orig_greek, greek, sizeof(greek)); // Keep the original order to verify against
     riffle(greek, greek_len, sizeof(char *), 3);
 
     // Check that shuffled Greek letter array contains all original elements
-    int check_greek = check_shuffle(greek, greek_len, sizeof(char *), cmp_str);
+    int check_greek = check_permutation(orig_greek, greek, greek_len, sizeof(char *), cmp_str);
     printf("Check shuffled Greek letter array: %s\n\n", check_greek ? "PASS" : "FAIL");
 
     // Print shuffled Greek letter array
@@ -51,16 +74,43 @@ int main() {
     }
     printf("\n\n");
 
+    // Shuffle an array of 256-byte records through an index permutation
+    Record records[16];
+    int records_len = sizeof(records) / sizeof(Record);
+    for (int i = 0; i < records_len; i++) {
+        records[i].id = i;
+        snprintf(records[i].payload, sizeof(records[i].payload), "record %d", i);
+    }
+    Record orig_records[sizeof(records) / sizeof(Record)];
+    memcpy(orig_records, records, sizeof(records));
+    riffle_indexed(records, records_len, sizeof(Record), 5);
+
+    // Check that shuffled record array contains all original records
+    int check_records = check_permutation(orig_records, records, records_len, sizeof(Record), cmp_record);
+    printf("Check shuffled record array: %s\n\n", check_records ? "PASS" : "FAIL");
+
+    // Print shuffled record ids
+    printf("Shuffled record array:\n");
+    printf("• ");
+    for (int i = 0; i < records_len; i++) {
+        printf("%d ", records[i].id);
+    }
+    printf("\n\n");
+
     return 0;
 }
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
  * gcc -c demo_shuffle.c -o demo_shuffle.o 
- * gcc riffle.o demo_shuffle.o -o demo_shuffle
+ * gcc -c metrics.c -o metrics.o
+ * gcc -c shuffles.c -o shuffles.o
+ * gcc -c perm_stats.c -o perm_stats.o
+ * gcc -c rng.c -o rng.o
+ * gcc riffle.o shuffles.o metrics.o perm_stats.o rng.o demo_shuffle.o -pthread -lm -o demo_shuffle
  * 
  * To run the program, type the following command:
  * ./demo_shuffle
  * 
- * The program will run the above function and will test check_shuffle function and will print Pass or Fail
+ * The program will run the above function and will test check_permutation function and will print Pass or Fail
  */
\ No newline at end of file
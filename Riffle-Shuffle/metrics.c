@@ -0,0 +1,263 @@
+/**
+*
+* @file metrics.c
+* @brief This program measures how well a set of shuffled permutations of 0, 1, ..., n-1 is mixed.
+* The fraction of adjacent ascents computed by quality() is already close to 0.5 after a single riffle,
+* so on its own it cannot tell how many riffles are needed. This file accumulates, over many trials,
+* the number of rising sequences (which a riffle at most doubles), the number of inversions, how far
+* elements move from their starting position, and how often each element lands in each position.
+* From these metrics_summary derives a total variation distance estimate and a chi-squared statistic
+* that can be compared against their values for a uniformly random permutation.
+* @author Josh
+* @bug No known bugs.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
+#include "perm_stats.h"
+
+/** Largest n for which the Eulerian numbers are computed exactly rather than approximated. */
+#define EULERIAN_EXACT_MAX_N 4096
+
+/**
+ * @brief Initialises an accumulator.
+ *
+ * @param m The accumulator to initialise.
+ * @param n Length of the permutations that will be added (at least 2).
+ * @param cells Number of buckets per axis of the chi-squared table (clamped to [2, n]).
+ * @param bins Number of bins of the displacement histogram (clamped to [1, n]).
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int metrics_init(ShuffleMetrics *m, int n, int cells, int bins) {
+    memset(m, 0, sizeof(*m));
+    if (n < 2) {
+        return -1;
+    }
+    if (cells < 2) cells = 2;
+    if (cells > n) cells = n;
+    if (bins < 1) bins = 1;
+    if (bins > n) bins = n;
+    m->n = n;
+    m->cells = cells;
+    m->bins = bins;
+
+    if (n <= METRICS_TVD_MAX_N) {
+        m->rising_hist = calloc(n, sizeof(long));
+    }
+    m->displacement_hist = calloc(bins, sizeof(long));
+    m->position_counts = calloc((size_t) cells * cells, sizeof(long));
+    m->pos = malloc(n * sizeof(int));
+    m->fenwick = malloc((n + 1) * sizeof(int));
+    if ((n <= METRICS_TVD_MAX_N && m->rising_hist == NULL) || m->displacement_hist == NULL
+            || m->position_counts == NULL || m->pos == NULL || m->fenwick == NULL) {
+        metrics_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds one shuffled permutation of 0, 1, ..., n-1 to an accumulator.
+ *
+ * The ascents and the total displacement are counted with the vectorised loops of perm_stats.c.
+ * The displacement histogram, the chi-squared table, the inverse permutation and the inversions are
+ * updated in one pass over perm; the inversions use a Fenwick tree over the values seen so far, so
+ * the pass costs O(n log n). The rising sequences are then counted from the inverse: value v+1
+ * starts a new rising sequence when it lies to the left of v, so they are one more than the
+ * descents of the inverse.
+ *
+ * @param m The accumulator.
+ * @param perm The permutation, of length m->n.
+ */
+void metrics_add(ShuffleMetrics *m, const int *perm) {
+    const int n = m->n;
+    const int cells = m->cells;
+    const int bins = m->bins;
+    int *pos = m->pos;
+    int *fenwick = m->fenwick;
+    long ascents = perm_count_ascents(perm, n);
+    long long inversions = 0;
+    long long displacement = perm_displacement(perm, n);
+
+    memset(fenwick, 0, (n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        int v = perm[i];
+        int d = v > i ? v - i : i - v;
+        m->displacement_hist[(long long) d * bins / n]++;
+
+        int element_cell = (int) ((long long) v * cells / n);
+        int position_cell = (int) ((long long) i * cells / n);
+        m->position_counts[element_cell * cells + position_cell]++;
+
+        pos[v] = i;
+
+        // of the i values already seen, those not counted by the prefix sum up to v are larger than v
+        int smaller = 0;
+        for (int k = v + 1; k > 0; k -= k & -k) {
+            smaller += fenwick[k];
+        }
+        inversions += i - smaller;
+        for (int k = v + 1; k <= n; k += k & -k) {
+            fenwick[k]++;
+        }
+    }
+
+    int rising = n - (int) perm_count_ascents(pos, n); // 1 + descents of the inverse
+
+    m->trials++;
+    m->ascents += ascents;
+    m->rising += rising;
+    m->inversions += (double) inversions;
+    m->displacement += (double) displacement;
+    if (m->rising_hist != NULL) {
+        m->rising_hist[rising - 1]++;
+    }
+}
+
+/**
+ * @brief Adds the counts of one accumulator to another with the same parameters.
+ *
+ * @param dst The accumulator to add to.
+ * @param src The accumulator to add.
+ */
+void metrics_merge(ShuffleMetrics *dst, const ShuffleMetrics *src) {
+    dst->trials += src->trials;
+    dst->ascents += src->ascents;
+    dst->rising += src->rising;
+    dst->inversions += src->inversions;
+    dst->displacement += src->displacement;
+    if (dst->rising_hist != NULL && src->rising_hist != NULL) {
+        for (int r = 0; r < dst->n; r++) {
+            dst->rising_hist[r] += src->rising_hist[r];
+        }
+    }
+    for (int b = 0; b < dst->bins; b++) {
+        dst->displacement_hist[b] += src->displacement_hist[b];
+    }
+    for (long c = 0; c < (long) dst->cells * dst->cells; c++) {
+        dst->position_counts[c] += src->position_counts[c];
+    }
+}
+
+/**
+ * @brief Computes the probability that a uniformly random permutation of length n has r rising sequences.
+ *
+ * A permutation has r rising sequences when its inverse has r-1 descents, so these are the Eulerian
+ * numbers A(n, r-1) divided by n!. They are computed exactly with the recurrence
+ * P(m, k) = ((k+1) P(m-1, k) + (m-k) P(m-1, k-1)) / m up to EULERIAN_EXACT_MAX_N, and from the
+ * normal approximation (mean (n-1)/2, variance (n+1)/12) above that.
+ *
+ * @param n Length of the permutations.
+ * @param p Array of n probabilities to fill; p[r-1] is the probability of r rising sequences.
+ */
+static void rising_distribution(int n, double *p) {
+    if (n <= EULERIAN_EXACT_MAX_N) {
+        memset(p, 0, n * sizeof(double));
+        p[0] = 1.0;
+        for (int len = 2; len <= n; len++) {
+            for (int k = len - 1; k >= 0; k--) {
+                double stay = (k + 1) * p[k];
+                double grow = k > 0 ? (len - k) * p[k - 1] : 0.0;
+                p[k] = (stay + grow) / len;
+            }
+        }
+        return;
+    }
+    double mean = (n - 1) / 2.0;
+    double sd = sqrt((n + 1) / 12.0);
+    for (int k = 0; k < n; k++) {
+        double lo = (k - 0.5 - mean) / (sd * sqrt(2.0));
+        double hi = (k + 0.5 - mean) / (sd * sqrt(2.0));
+        p[k] = 0.5 * (erf(hi) - erf(lo));
+    }
+}
+
+/**
+ * @brief Returns the first value of [0, n) that falls into bucket b of cells equal buckets.
+ *
+ * @param b The bucket.
+ * @param n Number of values.
+ * @param cells Number of buckets.
+ * @return The smallest x with x * cells / n == b.
+ */
+static long bucket_start(long b, long n, long cells) {
+    return (b * n + cells - 1) / cells;
+}
+
+/**
+ * @brief Computes summary statistics from an accumulator.
+ *
+ * @param m The accumulator.
+ * @return The summary.
+ */
+MetricsSummary metrics_summary(const ShuffleMetrics *m) {
+    MetricsSummary s;
+    memset(&s, 0, sizeof(s));
+    s.tvd_rising = NAN;
+    s.trials = m->trials;
+    if (m->trials == 0) {
+        return s;
+    }
+    const double trials = (double) m->trials;
+    const double n = (double) m->n;
+
+    s.quality = m->ascents / trials / (n - 1);
+    s.rising = m->rising / trials;
+    s.inversions = m->inversions / trials / (n * (n - 1) / 2);
+    s.displacement = m->displacement / trials / (n * n);
+
+    if (m->rising_hist != NULL) {
+        double *p = malloc(m->n * sizeof(double));
+        if (p != NULL) {
+            rising_distribution(m->n, p);
+            double distance = 0.0;
+            for (int r = 0; r < m->n; r++) {
+                distance += fabs(m->rising_hist[r] / trials - p[r]);
+            }
+            s.tvd_rising = distance / 2;
+            free(p);
+        }
+    }
+
+    // Under a uniform shuffle each element lands in each position with probability 1/n
+    double chi = 0.0;
+    for (int e = 0; e < m->cells; e++) {
+        long e_size = bucket_start(e + 1, m->n, m->cells) - bucket_start(e, m->n, m->cells);
+        for (int q = 0; q < m->cells; q++) {
+            long q_size = bucket_start(q + 1, m->n, m->cells) - bucket_start(q, m->n, m->cells);
+            double expected = trials * e_size * q_size / n;
+            double diff = m->position_counts[e * m->cells + q] - expected;
+            chi += diff * diff / expected;
+        }
+    }
+    s.chi_squared = chi;
+    s.chi_squared_dof = (m->cells - 1) * (m->cells - 1);
+    return s;
+}
+
+/**
+ * @brief Frees the memory held by an accumulator.
+ *
+ * @param m The accumulator.
+ */
+void metrics_free(ShuffleMetrics *m) {
+    free(m->rising_hist);
+    free(m->displacement_hist);
+    free(m->position_counts);
+    free(m->pos);
+    free(m->fenwick);
+    m->rising_hist = NULL;
+    m->displacement_hist = NULL;
+    m->position_counts = NULL;
+    m->pos = NULL;
+    m->fenwick = NULL;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c metrics.c -o metrics.o
+ * Programs using metrics.o must be linked with perm_stats.o and -lm.
+ * this file implements metrics_init, metrics_add, metrics_merge, metrics_summary, metrics_free functions.
+ */
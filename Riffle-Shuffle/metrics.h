@@ -0,0 +1,97 @@
+/**
+ * @file metrics.h
+ * @brief Header file for metrics.c, randomness metrics for shuffled permutations.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+/** Largest permutation length for which the rising sequence distribution is tabulated. */
+#define METRICS_TVD_MAX_N 65536
+
+/**
+ * @brief Accumulates randomness metrics over many shuffled permutations of 0, 1, ..., n-1.
+ *
+ * Every trial is added with metrics_add, which makes one pass over the permutation (plus one
+ * over its inverse for the rising sequences). Accumulators with the same parameters can be
+ * merged, so every thread can keep its own.
+ */
+typedef struct ShuffleMetrics {
+    int n;                     /**< Length of the permutations. */
+    int cells;                 /**< Number of element and position buckets of the chi-squared table. */
+    int bins;                  /**< Number of bins of the displacement histogram. */
+    long trials;               /**< Number of permutations added so far. */
+    double ascents;            /**< Sum over trials of the number of adjacent ascents. */
+    double rising;             /**< Sum over trials of the number of rising sequences. */
+    double inversions;         /**< Sum over trials of the number of inversions. */
+    double displacement;       /**< Sum over trials of the total displacement |pos - value|. */
+    long *rising_hist;         /**< Trials with r rising sequences, at index r-1 (NULL when n > METRICS_TVD_MAX_N). */
+    long *displacement_hist;   /**< Displacement counts, bucketed into bins bins over [0, n). */
+    long *position_counts;     /**< cells x cells counts of (element bucket, position bucket). */
+    int *pos;                  /**< Scratch: inverse permutation of the current trial. */
+    int *fenwick;              /**< Scratch: Fenwick tree used to count inversions. */
+} ShuffleMetrics;
+
+/**
+ * @brief Summary statistics derived from a ShuffleMetrics accumulator.
+ *
+ * For each statistic the value expected of a uniformly random permutation is given alongside.
+ */
+typedef struct {
+    long trials;               /**< Number of permutations summarised. */
+    double quality;            /**< Mean fraction of adjacent ascents (uniform: 0.5). */
+    double rising;             /**< Mean number of rising sequences (uniform: (n+1)/2). */
+    double inversions;         /**< Mean inversions as a fraction of n(n-1)/2 (uniform: 0.5). */
+    double displacement;       /**< Mean |pos - value| as a fraction of n (uniform: (n*n-1)/(3*n*n)). */
+    double tvd_rising;         /**< Total variation distance between the observed and uniform rising sequence distributions. */
+    double chi_squared;        /**< Chi-squared statistic of the element-at-position table. */
+    int chi_squared_dof;       /**< Degrees of freedom of chi_squared. */
+} MetricsSummary;
+
+/**
+ * @brief Initialises an accumulator.
+ *
+ * @param m The accumulator to initialise.
+ * @param n Length of the permutations that will be added (at least 2).
+ * @param cells Number of buckets per axis of the chi-squared table (clamped to [2, n]).
+ * @param bins Number of bins of the displacement histogram (clamped to [1, n]).
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int metrics_init(ShuffleMetrics *m, int n, int cells, int bins);
+
+/**
+ * @brief Adds one shuffled permutation of 0, 1, ..., n-1 to an accumulator.
+ *
+ * @param m The accumulator.
+ * @param perm The permutation, of length m->n.
+ */
+void metrics_add(ShuffleMetrics *m, const int *perm);
+
+/**
+ * @brief Adds the counts of one accumulator to another with the same parameters.
+ *
+ * @param dst The accumulator to add to.
+ * @param src The accumulator to add.
+ */
+void metrics_merge(ShuffleMetrics *dst, const ShuffleMetrics *src);
+
+/**
+ * @brief Computes summary statistics from an accumulator.
+ *
+ * tvd_rising is an estimate: it is a lower bound on the distance of the shuffle from uniform,
+ * since it only looks at one statistic, and it is biased upwards when there are few trials
+ * compared to n. It is NaN when n exceeds METRICS_TVD_MAX_N.
+ *
+ * @param m The accumulator.
+ * @return The summary.
+ */
+MetricsSummary metrics_summary(const ShuffleMetrics *m);
+
+/**
+ * @brief Frees the memory held by an accumulator.
+ *
+ * @param m The accumulator.
+ */
+void metrics_free(ShuffleMetrics *m);
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,218 @@
+/**
+*
+* @file perm_stats.c
+* @brief This program computes the per-trial statistics of shuffled int arrays with SIMD instructions.
+* Counting ascents and summing displacements is a pass over the whole array for every trial, as long as a
+* riffle itself, so on x86 these passes compare and add eight (AVX2) or four (SSE2) elements at a time.
+* The instruction set is picked at run time from what the CPU supports, so one binary runs everywhere;
+* other processors use the plain C loops, which the compiler may vectorise on its own.
+* @author Josh
+* @bug No known bugs.
+*/
+#include <stddef.h>
+#include "perm_stats.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERM_STATS_X86 1
+#include <immintrin.h>
+#endif
+
+/** Elements per block whose counts are kept in 32-bit vector lanes before being added up. */
+#define LANE_BLOCK ((size_t) 1 << 28)
+
+static PermIsa isa_limit = PERM_ISA_AVX2; /**< Set by perm_stats_limit. */
+
+/**
+ * @brief Counts the ascents of a[0..len) in plain C.
+ */
+static long ascents_scalar(const int *a, size_t len) {
+    long count = 0;
+    for (size_t i = 0; i + 1 < len; i++) {
+        count += a[i + 1] > a[i];
+    }
+    return count;
+}
+
+/**
+ * @brief Sums |perm[i] - (first + i)| over perm[0..len) in plain C.
+ */
+static long long displacement_scalar(const int *perm, size_t len, size_t first) {
+    long long sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        int d = perm[i] - (int) (first + i);
+        sum += d < 0 ? -d : d;
+    }
+    return sum;
+}
+
+#ifdef PERM_STATS_X86
+
+/**
+ * @brief Counts the ascents of a[0..len) four pairs at a time with SSE2.
+ */
+__attribute__((target("sse2")))
+static long ascents_sse2(const int *a, size_t len) {
+    long count = 0;
+    size_t i = 0;
+    while (i + 4 < len) {
+        size_t end = len - 4 < i + LANE_BLOCK ? len - 4 : i + LANE_BLOCK;
+        __m128i acc = _mm_setzero_si128();
+        for (; i < end; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+            __m128i y = _mm_loadu_si128((const __m128i *) (a + i + 1));
+            acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(y, x)); // a true comparison is -1
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, acc);
+        count += (long) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return count + ascents_scalar(a + i, len - i);
+}
+
+/**
+ * @brief Sums |perm[i] - i| four elements at a time with SSE2, widening to 64 bits.
+ */
+__attribute__((target("sse2")))
+static long long displacement_sse2(const int *perm, size_t len) {
+    __m128i acc = _mm_setzero_si128();
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i four = _mm_set1_epi32(4);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i d = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (perm + i)), index);
+        __m128i sign = _mm_srai_epi32(d, 31);
+        d = _mm_sub_epi32(_mm_xor_si128(d, sign), sign); // |d|, which is non-negative
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(d, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(d, zero));
+        index = _mm_add_epi32(index, four);
+    }
+    long long lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    return lanes[0] + lanes[1] + displacement_scalar(perm + i, len - i, i);
+}
+
+/**
+ * @brief Counts the ascents of a[0..len) eight pairs at a time with AVX2.
+ */
+__attribute__((target("avx2")))
+static long ascents_avx2(const int *a, size_t len) {
+    long count = 0;
+    size_t i = 0;
+    while (i + 8 < len) {
+        size_t end = len - 8 < i + LANE_BLOCK ? len - 8 : i + LANE_BLOCK;
+        __m256i acc = _mm256_setzero_si256();
+        for (; i < end; i += 8) {
+            __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i *) (a + i + 1));
+            acc = _mm256_sub_epi32(acc, _mm256_cmpgt_epi32(y, x));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        int lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, sum);
+        count += (long) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return count + ascents_scalar(a + i, len - i);
+}
+
+/**
+ * @brief Sums |perm[i] - i| eight elements at a time with AVX2, widening to 64 bits.
+ */
+__attribute__((target("avx2")))
+static long long displacement_avx2(const int *perm, size_t len) {
+    __m256i acc = _mm256_setzero_si256();
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i eight = _mm256_set1_epi32(8);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (perm + i)), index));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(d)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(d, 1)));
+        index = _mm256_add_epi32(index, eight);
+    }
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + displacement_scalar(perm + i, len - i, i);
+}
+
+#endif /* PERM_STATS_X86 */
+
+/**
+ * @brief Returns the instruction set the functions currently use.
+ *
+ * @return The fastest instruction set that the CPU supports and perm_stats_limit allows.
+ */
+PermIsa perm_stats_isa(void) {
+#ifdef PERM_STATS_X86
+    if (isa_limit >= PERM_ISA_AVX2 && __builtin_cpu_supports("avx2")) {
+        return PERM_ISA_AVX2;
+    }
+    if (isa_limit >= PERM_ISA_SSE2 && __builtin_cpu_supports("sse2")) {
+        return PERM_ISA_SSE2;
+    }
+#endif
+    return PERM_ISA_SCALAR;
+}
+
+/**
+ * @brief Returns the name of an instruction set.
+ *
+ * @param isa The instruction set.
+ * @return "scalar", "sse2" or "avx2".
+ */
+const char *perm_isa_name(PermIsa isa) {
+    switch (isa) {
+    case PERM_ISA_AVX2: return "avx2";
+    case PERM_ISA_SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+/**
+ * @brief Restricts the functions to at most the given instruction set.
+ *
+ * @param max The fastest instruction set allowed.
+ */
+void perm_stats_limit(PermIsa max) {
+    isa_limit = max;
+}
+
+/**
+ * @brief Counts the adjacent ascents a[i] < a[i + 1] of an int array.
+ *
+ * @param a The array.
+ * @param len Length of the array.
+ * @return The number of ascents.
+ */
+long perm_count_ascents(const int *a, size_t len) {
+    switch (perm_stats_isa()) {
+#ifdef PERM_STATS_X86
+    case PERM_ISA_AVX2: return ascents_avx2(a, len);
+    case PERM_ISA_SSE2: return ascents_sse2(a, len);
+#endif
+    default: return ascents_scalar(a, len);
+    }
+}
+
+/**
+ * @brief Sums the displacements |perm[i] - i| of a permutation.
+ *
+ * @param perm The permutation.
+ * @param len Length of the permutation.
+ * @return The total displacement.
+ */
+long long perm_displacement(const int *perm, size_t len) {
+    switch (perm_stats_isa()) {
+#ifdef PERM_STATS_X86
+    case PERM_ISA_AVX2: return displacement_avx2(perm, len);
+    case PERM_ISA_SSE2: return displacement_sse2(perm, len);
+#endif
+    default: return displacement_scalar(perm, len, 0);
+    }
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c perm_stats.c -o perm_stats.o
+ * this file implements perm_count_ascents, perm_displacement, perm_stats_isa, perm_isa_name and perm_stats_limit.
+ */
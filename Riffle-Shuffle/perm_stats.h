@@ -0,0 +1,65 @@
+/**
+ * @file perm_stats.h
+ * @brief Header file for perm_stats.c, vectorised statistics of int arrays.
+ *
+ * On x86 the functions use AVX2 or SSE2 when the CPU supports them, chosen at run time, and
+ * plain C otherwise. Every implementation returns exactly the same result.
+ */
+
+#ifndef PERM_STATS_H_
+#define PERM_STATS_H_
+
+#include <stddef.h>
+
+/**
+ * @brief Instruction sets perm_stats can use, from slowest to fastest.
+ */
+typedef enum {
+    PERM_ISA_SCALAR = 0,  /**< Plain C. */
+    PERM_ISA_SSE2 = 1,    /**< 128-bit SSE2. */
+    PERM_ISA_AVX2 = 2     /**< 256-bit AVX2. */
+} PermIsa;
+
+/**
+ * @brief Counts the adjacent ascents a[i] < a[i + 1] of an int array.
+ *
+ * @param a The array.
+ * @param len Length of the array.
+ * @return The number of ascents (0 if len < 2).
+ */
+long perm_count_ascents(const int *a, size_t len);
+
+/**
+ * @brief Sums the displacements |perm[i] - i| of a permutation of 0, 1, ..., len-1.
+ *
+ * @param perm The permutation.
+ * @param len Length of the permutation (at most INT_MAX).
+ * @return The total displacement.
+ */
+long long perm_displacement(const int *perm, size_t len);
+
+/**
+ * @brief Returns the instruction set the functions above currently use.
+ *
+ * @return The instruction set.
+ */
+PermIsa perm_stats_isa(void);
+
+/**
+ * @brief Returns the name of an instruction set, e.g. "avx2".
+ *
+ * @param isa The instruction set.
+ * @return Its name.
+ */
+const char *perm_isa_name(PermIsa isa);
+
+/**
+ * @brief Restricts the functions above to at most the given instruction set, for benchmarks and tests.
+ *
+ * Not thread-safe; call it before starting any threads that use perm_stats.
+ *
+ * @param max The fastest instruction set allowed; the CPU's support still applies.
+ */
+void perm_stats_limit(PermIsa max);
+
+#endif /* PERM_STATS_H_ */
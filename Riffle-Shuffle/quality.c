@@ -1,60 +1,306 @@
 /**
  * @file quality.c
- * @brief A program to calculate the average quality of a riffle shuffle
- * of an array of length 50 using N = 1, 2, 3, ..., 15.
+ * @brief A program to measure the quality of a riffle shuffle, or of the other shuffle algorithms
+ * of riffle.h, over a grid of array lengths, riffle counts and trial counts.
+ *
+ * Every cell of the grid is estimated with average_quality_algorithm, which spreads the trials over
+ * worker threads, and is written as one CSV or JSON Lines row as soon as it finishes, together
+ * with how long it took. With no arguments it reproduces the original experiment: an array of
+ * length 50, N = 1, 2, 3, ..., 15 riffles and 30 trials.
  */
 
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "riffle.h"
 
 /**
- * @brief The main function that calculates the average quality of a riffle shuffle
- * and writes the output to a file.
+ * @brief An inclusive range of values, stepped either by adding or by multiplying.
+ */
+typedef struct {
+    long start;      /**< First value. */
+    long stop;       /**< Last value (inclusive). */
+    long step;       /**< Increment, or factor if geometric is set. */
+    int geometric;   /**< 1 if values are multiplied by step, 0 if step is added. */
+} Range;
+
+/**
+ * @brief Parses a range of the form START[:STOP[:STEP]], where STEP is either a number to add
+ * or xFACTOR to multiply by, e.g. "50", "1:15", "10:100000000:x10".
  *
- * @return 0 on success, non-zero value on failure
+ * @param text The text to parse.
+ * @param range The range to fill in.
+ * @return 0 on success, -1 if the text is not a valid range or STOP is above INT_MAX.
  */
-int main(void) {
-    const int len = 50;             // Length of the array
-    // const int shuffles = 10;      // Number of shuffles
-    const int trials = 30;          // Number of trials
-
-    FILE *output_file = fopen("quality.txt", "w");   // Open output file for writing
-    if (output_file == NULL) {
-        perror("Failed to open output file");
-        return EXIT_FAILURE;
+static int parse_range(const char *text, Range *range) {
+    char *end;
+    range->start = strtol(text, &end, 10);
+    range->stop = range->start;
+    range->step = 1;
+    range->geometric = 0;
+    if (*end == ':') {
+        range->stop = strtol(end + 1, &end, 10);
+        if (*end == ':') {
+            if (end[1] == 'x') {
+                range->geometric = 1;
+                end++;
+            }
+            range->step = strtol(end + 1, &end, 10);
+        }
     }
+    if (*end != '\0' || range->start < 1 || range->stop < range->start || range->stop > INT_MAX
+            || range->step < 1 || (range->geometric && range->step < 2)) {
+        return -1;
+    }
+    return 0;
+}
 
-    fprintf(output_file, "N\tAvg. Quality\n");
+/**
+ * @brief Returns the value after value in a range, without computing a value past stop.
+ *
+ * @param range The range.
+ * @param value The current value.
+ * @return The next value, or 0 when value is the last one.
+ */
+static long range_next(const Range *range, long value) {
+    if (range->geometric) {
+        return value > range->stop / range->step ? 0 : value * range->step;
+    }
+    return value > range->stop - range->step ? 0 : value + range->step;
+}
 
-    int *numbers = malloc(len * sizeof(int));
-    if (numbers == NULL) {
-        perror("Failed to allocate memory for numbers");
-        fclose(output_file);
-        return EXIT_FAILURE;
+/**
+ * @brief Returns the time of a monotonic clock in seconds.
+ *
+ * @return The time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Prints the usage message.
+ *
+ * @param program The name the program was run as.
+ */
+static void usage(const char *program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -n, --len RANGE       array lengths (default 50)\n"
+        "  -r, --riffles RANGE   riffles per trial (default 1:15)\n"
+        "  -t, --trials RANGE    trials per cell (default 30)\n"
+        "  -a, --algorithm LIST  comma-separated shuffle algorithms, or all (default riffle)\n"
+        "  -j, --threads N       worker threads, 0 for one per CPU (default 0)\n"
+        "  -s, --seed N          random seed (default: the current time)\n"
+        "  -f, --format FMT      csv or jsonl (default csv)\n"
+        "  -m, --metrics         also report rising sequences, inversions, TVD and chi-squared\n"
+        "  -o, --output FILE     write the rows to FILE instead of standard output\n"
+        "A RANGE is START[:STOP[:STEP]]; STEP may be xFACTOR for a geometric range, e.g. 10:100000000:x10.\n"
+        "For algorithms that are uniform after one pass the riffle count is ignored.\n",
+        program);
+    fprintf(stderr, "Algorithms:");
+    for (int i = 0; shuffle_algorithms[i] != NULL; i++) {
+        fprintf(stderr, " %s", shuffle_algorithms[i]->name);
+    }
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Parses a comma-separated list of algorithm names, or "all".
+ *
+ * @param text The text to parse.
+ * @param algos Array receiving the algorithms.
+ * @param capacity Number of entries in algos.
+ * @return The number of algorithms, or -1 if a name is unknown or there are too many.
+ */
+static int parse_algorithms(const char *text, const ShuffleAlgorithm **algos, int capacity) {
+    int count = 0;
+    if (strcmp(text, "all") == 0) {
+        while (shuffle_algorithms[count] != NULL && count < capacity) {
+            algos[count] = shuffle_algorithms[count];
+            count++;
+        }
+        return count;
     }
-    for (int N = 1; N <= 15; N++) {
-        for (int i = 0; i < len; i++) {
-            numbers[i] = i;
+    char name[64];
+    while (*text != '\0') {
+        size_t n = strcspn(text, ",");
+        if (n == 0 || n >= sizeof(name)) {
+            return -1;
+        }
+        memcpy(name, text, n);
+        name[n] = '\0';
+        const ShuffleAlgorithm *algo = shuffle_algorithm_find(name);
+        if (algo == NULL) {
+            fprintf(stderr, "Error: unknown algorithm %s\n", name);
+            return -1;
         }
+        if (count == capacity) {
+            return -1;
+        }
+        algos[count++] = algo;
+        text += text[n] == ',' ? n + 1 : n;
+    }
+    return count > 0 ? count : -1;
+}
 
-        int shuffles = N; // N may be the no. of shuffles that we need to find, if not then just comment this line and uncomment line 19
-        float avg_quality = average_quality(len, shuffles, trials);
+/**
+ * @brief The main function that runs the sweep and streams one row per cell.
+ *
+ * @param argc The number of command line arguments
+ * @param argv An array of strings containing the command line arguments
+ * @return 0 on success, non-zero value on failure
+ */
+int main(int argc, char *argv[]) {
+    Range lens = {50, 50, 1, 0};
+    Range riffles = {1, 15, 1, 0};
+    Range trials = {30, 30, 1, 0};
+    int threads = 0;
+    uint64_t seed = (uint64_t) time(NULL);
+    int jsonl = 0;
+    int with_metrics = 0;
+    const char *output = NULL;
+    const ShuffleAlgorithm *algos[16] = {&shuffle_riffle};
+    int num_algos = 1;
 
-        fprintf(output_file, "%d\t%.4f\n", N, avg_quality);
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        int has_value = i + 1 < argc;
+        Range *range = NULL;
+        if (strcmp(opt, "-n") == 0 || strcmp(opt, "--len") == 0) {
+            range = &lens;
+        } else if (strcmp(opt, "-r") == 0 || strcmp(opt, "--riffles") == 0) {
+            range = &riffles;
+        } else if (strcmp(opt, "-t") == 0 || strcmp(opt, "--trials") == 0) {
+            range = &trials;
+        } else if ((strcmp(opt, "-j") == 0 || strcmp(opt, "--threads") == 0) && has_value) {
+            threads = atoi(argv[++i]);
+            continue;
+        } else if ((strcmp(opt, "-s") == 0 || strcmp(opt, "--seed") == 0) && has_value) {
+            seed = strtoull(argv[++i], NULL, 10);
+            continue;
+        } else if ((strcmp(opt, "-f") == 0 || strcmp(opt, "--format") == 0) && has_value) {
+            const char *format = argv[++i];
+            if (strcmp(format, "jsonl") != 0 && strcmp(format, "csv") != 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            jsonl = strcmp(format, "jsonl") == 0;
+            continue;
+        } else if ((strcmp(opt, "-a") == 0 || strcmp(opt, "--algorithm") == 0) && has_value) {
+            num_algos = parse_algorithms(argv[++i], algos, 16);
+            if (num_algos < 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            continue;
+        } else if (strcmp(opt, "-m") == 0 || strcmp(opt, "--metrics") == 0) {
+            with_metrics = 1;
+            continue;
+        } else if ((strcmp(opt, "-o") == 0 || strcmp(opt, "--output") == 0) && has_value) {
+            output = argv[++i];
+            continue;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (!has_value || parse_range(argv[++i], range) != 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (lens.start < 2 || lens.stop > 2147483647L) {
+        fprintf(stderr, "Error: array lengths must be between 2 and 2147483647\n");
+        return EXIT_FAILURE;
     }
 
-    free(numbers);
-    fprintf(output_file, "\n\nExplanation:\n    Based on the output of the average_quality function, \n\
-    it seems that the quality of the shuffling algorithm improves as the number of shuffles increases, up to a certain point. \n\
-    Specifically, for an array of size 50 and 30 trials, we can see that we need at least 7 shuffles to achieve an average quality close to 0.5. \n\
-    This suggests that the algorithm becomes more effective at randomizing the elements of the array as more shuffles are performed, \n\
-    up to a point where further shuffling doesn't yield much additional improvement in quality. \n\n\
-    It's important to note that the quality values reported here are specific to the parameters used in the function, and may not be generalizable to other scenarios. \n\
-    However, this information can be useful in guiding decisions about how many shuffles to use when randomizing an array of this size\n");
+    FILE *output_file = stdout;
+    if (output != NULL) {
+        output_file = fopen(output, "w");   // Open output file for writing
+        if (output_file == NULL) {
+            perror("Failed to open output file");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!jsonl) {
+        fprintf(output_file, "algorithm,len,riffles,trials,seed,quality,std_dev,ci_low,ci_high");
+        if (with_metrics) {
+            fprintf(output_file, ",rising,inversions,displacement,tvd_rising,chi_squared,chi_squared_dof");
+        }
+        fprintf(output_file, ",seconds,trials_per_second,elements_per_second\n");
+    }
+
+    uint64_t cell = 0;
+    for (int a = 0; a < num_algos; a++) {
+        const ShuffleAlgorithm *algo = algos[a];
+        for (long len = lens.start; len != 0; len = range_next(&lens, len)) {
+            for (long N = riffles.start; N != 0; N = range_next(&riffles, N)) {
+                for (long T = trials.start; T != 0; T = range_next(&trials, T)) {
+                    uint64_t cell_seed = seed + cell++; // rng_seed decorrelates consecutive seeds
+                    ShuffleMetrics metrics;
+                    if (with_metrics && metrics_init(&metrics, (int) len, 16, 16) != 0) {
+                        fprintf(stderr, "Failed to allocate memory for the metrics of length %ld\n", len);
+                        return EXIT_FAILURE;
+                    }
+
+                    double started = now_seconds();
+                    QualityStats stats = average_quality_algorithm(algo, (int) len, (int) N, T, threads, cell_seed,
+                                                                   with_metrics ? &metrics : NULL);
+                    double seconds = now_seconds() - started;
+                    double trials_per_second = seconds > 0 ? T / seconds : 0.0;
+                    double passes = algo->uses_passes ? N : 1;
+                    double elements_per_second = trials_per_second * len * passes; // elements shuffled per second
 
+                    MetricsSummary summary;
+                    if (with_metrics) {
+                        summary = metrics_summary(&metrics);
+                        metrics_free(&metrics);
+                    }
 
-    fclose(output_file);    // Close output file
+                    if (jsonl) {
+                        fprintf(output_file, "{\"algorithm\":\"%s\",\"len\":%ld,\"riffles\":%ld,\"trials\":%ld,\"seed\":%" PRIu64 ","
+                                "\"quality\":%.6f,\"std_dev\":%.6f,\"ci_low\":%.6f,\"ci_high\":%.6f",
+                                algo->name, len, N, T, cell_seed, stats.mean, stats.std_dev, stats.ci_low, stats.ci_high);
+                        if (with_metrics) {
+                            fprintf(output_file, ",\"rising\":%.4f,\"inversions\":%.6f,\"displacement\":%.6f,",
+                                    summary.rising, summary.inversions, summary.displacement);
+                            if (summary.tvd_rising == summary.tvd_rising) {
+                                fprintf(output_file, "\"tvd_rising\":%.6f", summary.tvd_rising);
+                            } else {
+                                fprintf(output_file, "\"tvd_rising\":null"); // JSON has no NaN
+                            }
+                            fprintf(output_file, ",\"chi_squared\":%.3f,\"chi_squared_dof\":%d",
+                                    summary.chi_squared, summary.chi_squared_dof);
+                        }
+                        fprintf(output_file, ",\"seconds\":%.6f,\"trials_per_second\":%.1f,\"elements_per_second\":%.1f}\n",
+                                seconds, trials_per_second, elements_per_second);
+                    } else {
+                        fprintf(output_file, "%s,%ld,%ld,%ld,%" PRIu64 ",%.6f,%.6f,%.6f,%.6f",
+                                algo->name, len, N, T, cell_seed, stats.mean, stats.std_dev, stats.ci_low, stats.ci_high);
+                        if (with_metrics) {
+                            fprintf(output_file, ",%.4f,%.6f,%.6f,%.6f,%.3f,%d",
+                                    summary.rising, summary.inversions, summary.displacement,
+                                    summary.tvd_rising, summary.chi_squared, summary.chi_squared_dof);
+                        }
+                        fprintf(output_file, ",%.6f,%.1f,%.1f\n", seconds, trials_per_second, elements_per_second);
+                    }
+                    fflush(output_file); // stream each row as soon as its cell is done
+                }
+            }
+        }
+    }
+
+    if (output_file != stdout) {
+        fclose(output_file);    // Close output file
+    }
 
     return 0;
 }
@@ -62,11 +308,17 @@ int main(void) {
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
- * gcc -c quality.c -o quality.o 
- * gcc riffle.o quality.o -o quality
- * 
+ * gcc -c quality.c -o quality.o
+ * gcc -c metrics.c -o metrics.o
+ * gcc -c shuffles.c -o shuffles.o
+ * gcc -c perm_stats.c -o perm_stats.o
+ * gcc -c rng.c -o rng.o
+ * gcc riffle.o shuffles.o metrics.o perm_stats.o rng.o quality.o -pthread -lm -o quality
+ *
  * To run the program, type the following command:
  * ./quality
- * 
- * The program will run the above function and will test avg_quality of array of length 50 for different N.
- */
\ No newline at end of file
+ * ./quality -n 10:100000000:x10 -r 1:12 -t 1000 -f jsonl -o sweep.jsonl
+ * ./quality -a all -n 1000000 -r 1:8 -t 20
+ *
+ * Without options the program reports the average quality of an array of length 50 for N = 1, ..., 15.
+ */
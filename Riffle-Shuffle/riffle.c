@@ -6,16 +6,27 @@
 * The first item in the new array will be the first item from one of the two half arrays, chosen with an equal probability;
 * that is, there is a 50% chance that it is the first item of array A and 50% chance that it is the first item from array B.
 * Likewise, each successive item in the shuffled array is, with equal probability, the next available item of A or B.
-* This program defines a procedure riffle_once(void *L, int len, int size, void *work) which performs a single riffle shuffle of the array L
+* This program defines a procedure riffle_once(void *L, size_t len, size_t size, void *work) which performs a single riffle shuffle of the array L
 * each of whose len elements is of size size bytes.
 * The array work is an additional array of at least the same size as L that can be used as workspace.
+* The coin tosses come from an Rng passed by the caller (the _r functions); the original signatures
+* remain as wrappers that seed a private Rng from rand().
 * @author Josh
 * @bug No known bugs.
 */
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include "perm_stats.h"
+#include "riffle.h"
+#include "rng.h"
 
 /**
  * Compares two integers.
@@ -23,9 +34,9 @@
  * @param b The second integer.
  * @return -1 if a < b, 0 if a == b, +1 if a > b.
  */
-int cmp_int(void *a, void *b) {
-    int x = *((int *) a);
-    int y = *((int *) b);
+int cmp_int(const void *a, const void *b) {
+    int x = *((const int *) a);
+    int y = *((const int *) b);
     if (x < y) return -1;
     if (x == y) return 0;
     return 1;
@@ -33,81 +44,329 @@ int cmp_int(void *a, void *b) {
 
 /**
  * Compares two strings.
- * @param a The first string.
- * @param b The second string.
- * @return -1 if a < b, 0 if a == b, +1 if a > b.
+ * The arguments point at the array elements, i.e. at the char * pointers, so they are
+ * dereferenced once before comparing (this also makes cmp_str usable with qsort).
+ * @param a Pointer to the first string.
+ * @param b Pointer to the second string.
+ * @return <0 if a < b, 0 if a == b, >0 if a > b.
  */
-int cmp_str(void *a, void *b) {
-    return strcmp((char *) a, (char *) b);
+int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
 }
 
 /**
-*
-* @brief This procedure performs a single riffle shuffle of the array L.
-* @param L A pointer to the array to be shuffled.
+* @brief Performs a single riffle shuffle of the array src, writing the result to dst.
+* @param src A pointer to the array to be shuffled; it is not modified.
+* @param dst A pointer to an array of the same size as src that receives the shuffled elements.
 * @param len The number of elements in the array.
 * @param size The size of each element in bytes.
-* @param work An additional array of at least the same size as L that can be used as workspace.
+* @param rng The random number generator used for the coin tosses.
 * @return Void.
 */
-void riffle_once(void *L, int len, int size, void *work) {
-    int half = len / 2;
-    char *left_hand = (char *) L;
-    char *dst = (char *) work;
-    char *right_hand = (char *) L + half*size;
+void riffle_into(const void *src, void *dst, size_t len, size_t size, Rng *rng) {
+    size_t half = len / 2;
+    const char *left_hand = (const char *) src;
+    const char *right_hand = (const char *) src + half*size;
+    char *out = (char *) dst;
     
-    int i, j;
+    size_t i, j;
 
     for (i = 0, j = 0; i < half && j < len - half; ) {
-        if (rand() % 2) { // when random number generated is odd (similar as tossing a coin, probability = 0.5)
-            memcpy(dst, left_hand, size);
+        if (rng_bit(rng)) { // tossing a coin, probability = 0.5
+            memcpy(out, left_hand, size);
             left_hand += size;
             i++;
         } else { // copy from second half of the array
-            memcpy(dst, right_hand, size);
+            memcpy(out, right_hand, size);
             right_hand += size;
             j++;
         }
-        dst += size;
+        out += size;
     }
 
-    while (i < len/2) { // copy the remaining element in the first half of the array
-        memcpy(dst, left_hand, size);
-        left_hand += size;
-        dst += size;
-        i++;
+    // copy the remaining elements of whichever half is left; they are contiguous
+    memcpy(out, left_hand, (half - i) * size);
+    out += (half - i) * size;
+    memcpy(out, right_hand, (len - half - j) * size);
+}
+
+/**
+* @brief Riffles an int array from src into dst like riffle_into and counts the ascents of dst on the way.
+* The coin loop compares every element it writes with the one written before it, and the tails are counted
+* with perm_count_ascents, so the result can be measured without another pass over dst.
+* @param src A pointer to the array to be shuffled; it is not modified.
+* @param dst A pointer to an array of the same length receiving the shuffled elements.
+* @param len The number of elements in the array.
+* @param rng The random number generator used for the coin tosses; it is used exactly as by riffle_into.
+* @return The number of adjacent ascents dst[k] < dst[k + 1].
+*/
+long riffle_into_ascents(const int *src, int *dst, size_t len, Rng *rng) {
+    size_t half = len / 2;
+    const int *left_hand = src;
+    const int *right_hand = src + half;
+    int *out = dst;
+    int prev = INT_MAX; // nothing is greater, so the first element is never counted
+    long ascents = 0;
+
+    size_t i, j;
+
+    for (i = 0, j = 0; i < half && j < len - half; ) {
+        int v;
+        if (rng_bit(rng)) {
+            v = *left_hand++;
+            i++;
+        } else {
+            v = *right_hand++;
+            j++;
+        }
+        ascents += v > prev;
+        prev = v;
+        *out++ = v;
     }
 
-    while (j < len - len/2) { // copy the remaining element in the second half of the array
-        memcpy(dst, right_hand, size);
-        right_hand += size;
-        dst += size;
-        j++;
+    // at most one of the two tails is non-empty
+    const int *tail = i < half ? left_hand : right_hand;
+    size_t tail_len = i < half ? half - i : len - half - j;
+    if (tail_len > 0) {
+        memcpy(out, tail, tail_len * sizeof(int));
+        ascents += (tail[0] > prev) + perm_count_ascents(tail, tail_len);
     }
+    return ascents;
+}
 
+/**
+* @brief Performs a single riffle shuffle of the array L, drawing coin tosses from rng.
+* @param L A pointer to the array to be shuffled.
+* @param len The number of elements in the array.
+* @param size The size of each element in bytes.
+* @param work An additional array of at least the same size as L that can be used as workspace.
+* @param rng The random number generator used for the coin tosses.
+* @return Void.
+*/
+void riffle_once_r(void *L, size_t len, size_t size, void *work, Rng *rng) {
+    riffle_into(L, work, len, size, rng);
     memcpy(L, work, len*size);
 }
 
 /**
- * @brief Shuffles an array by performing N riffles.
+ * @brief Draws a 62-bit seed from rand(), so that srand() still makes the wrapper functions reproducible.
+ *
+ * @return The seed.
+ */
+static uint64_t seed_from_rand(void) {
+    return ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+}
+
+/**
+ * @brief Seeds an Rng from rand().
+ *
+ * @param rng The generator to seed.
+ */
+static void rng_seed_from_rand(Rng *rng) {
+    rng_seed(rng, seed_from_rand());
+}
+
+/**
+*
+* @brief This procedure performs a single riffle shuffle of the array L.
+* The coin tosses come from a generator seeded from rand(), so srand() still makes a run reproducible.
+* @param L A pointer to the array to be shuffled.
+* @param len The number of elements in the array.
+* @param size The size of each element in bytes.
+* @param work An additional array of at least the same size as L that can be used as workspace.
+* @return Void.
+*/
+void riffle_once(void *L, size_t len, size_t size, void *work) {
+    Rng rng;
+    rng_seed_from_rand(&rng);
+    riffle_once_r(L, len, size, work, &rng);
+}
+
+/**
+ * @brief Shuffles an array by performing N riffles, drawing coin tosses from rng.
  *
  * @param L Pointer to the array to shuffle.
  * @param len Length of the array.
  * @param size Size of each element in the array.
  * @param N Number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
  */
-void riffle(void *L, int len, int size, int N) {
+void riffle_r(void *L, size_t len, size_t size, int N, Rng *rng) {
     void *work = malloc(len * size); // allocate memory for workspace
     if (work == NULL) {
         fprintf(stderr, "Error: Memory allocation failed.\n");
         exit(EXIT_FAILURE);
     }
     for (int i = 0; i < N; i++) {
-        riffle_once(L, len, size, work); // shuffle work and copy to L
+        riffle_once_r(L, len, size, work, rng); // shuffle work and copy to L
     }
     free(work); // free dynamically allocated memory
 }
 
+/**
+ * @brief Shuffles an array by performing N riffles.
+ * The coin tosses come from a generator seeded from rand().
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ */
+void riffle(void *L, size_t len, size_t size, int N) {
+    Rng rng;
+    rng_seed_from_rand(&rng);
+    riffle_r(L, len, size, N, &rng);
+}
+
+/**
+ * @brief Riffles the identity permutation 0, 1, ..., len-1 N times.
+ * Indices are 4 bytes wide when len fits in 32 bits and 8 bytes wide otherwise. The riffles
+ * alternate between two index arrays with riffle_into, so no riffle needs a copy back.
+ *
+ * @param len Length of the array being shuffled.
+ * @param N Number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
+ * @param wide Set to 1 if the returned indices are uint64_t, 0 if they are uint32_t.
+ * @return A newly allocated array of len indices: element i of the shuffled array is element idx[i] of the original.
+ */
+static void *riffle_indices(size_t len, int N, Rng *rng, int *wide) {
+    *wide = len > UINT32_MAX;
+    size_t width = *wide ? sizeof(uint64_t) : sizeof(uint32_t);
+    char *idx = malloc(2 * len * width); // two index arrays to alternate between
+    if (idx == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (*wide) {
+            ((uint64_t *) idx)[i] = i;
+        } else {
+            ((uint32_t *) idx)[i] = (uint32_t) i;
+        }
+    }
+    char *src = idx;
+    char *dst = idx + len * width;
+    for (int i = 0; i < N; i++) {
+        riffle_into(src, dst, len, width, rng);
+        char *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != idx) {
+        memcpy(idx, src, len * width);
+    }
+    return idx; // the second half of the block is simply left unused until free
+}
+
+/**
+ * @brief Reads entry i of an index array of either width.
+ *
+ * @param idx The index array.
+ * @param wide 1 for uint64_t entries, 0 for uint32_t entries.
+ * @param i The entry to read.
+ * @return The index.
+ */
+static size_t index_at(const void *idx, int wide, size_t i) {
+    return wide ? (size_t) ((const uint64_t *) idx)[i] : ((const uint32_t *) idx)[i];
+}
+
+/**
+ * @brief Writes entry i of an index array of either width.
+ *
+ * @param idx The index array.
+ * @param wide 1 for uint64_t entries, 0 for uint32_t entries.
+ * @param i The entry to write.
+ * @param value The index to store.
+ */
+static void index_set(void *idx, int wide, size_t i, size_t value) {
+    if (wide) {
+        ((uint64_t *) idx)[i] = value;
+    } else {
+        ((uint32_t *) idx)[i] = (uint32_t) value;
+    }
+}
+
+/**
+ * @brief Shuffles an array of large elements by riffling an index array N times and then moving
+ * every element once.
+ *
+ * The permutation is applied in place by following its cycles: the first element of each cycle
+ * is saved, the rest of the cycle is shifted along, and the saved element closes it. Finished
+ * entries are marked in the index array itself, so the only extra memory is the index arrays and
+ * one element. The result is the same as riffle_r with the same generator state.
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
+ */
+void riffle_indexed_r(void *L, size_t len, size_t size, int N, Rng *rng) {
+    if (len < 2) {
+        return;
+    }
+    int wide;
+    void *idx = riffle_indices(len, N, rng, &wide);
+    char *tmp = malloc(size);
+    if (tmp == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *base = (char *) L;
+    for (size_t start = 0; start < len; start++) {
+        if (index_at(idx, wide, start) == start) {
+            continue; // a fixed point, or a cycle that has already been moved
+        }
+        memcpy(tmp, base + start * size, size);
+        size_t j = start;
+        size_t k;
+        while ((k = index_at(idx, wide, j)) != start) {
+            memcpy(base + j * size, base + k * size, size);
+            index_set(idx, wide, j, j);
+            j = k;
+        }
+        memcpy(base + j * size, tmp, size);
+        index_set(idx, wide, j, j);
+    }
+    free(tmp);
+    free(idx);
+}
+
+/**
+ * @brief Writes a shuffled copy of src to dst by riffling an index array N times and then
+ * gathering every element once.
+ *
+ * @param src Pointer to the array to shuffle; it is not modified.
+ * @param dst Pointer to an array of the same size that receives the shuffled elements.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
+ */
+void riffle_indexed_into_r(const void *src, void *dst, size_t len, size_t size, int N, Rng *rng) {
+    int wide;
+    void *idx = riffle_indices(len, N, rng, &wide);
+    for (size_t i = 0; i < len; i++) {
+        memcpy((char *) dst + i * size, (const char *) src + index_at(idx, wide, i) * size, size);
+    }
+    free(idx);
+}
+
+/**
+ * @brief Shuffles an array of large elements by performing N riffles on an index array.
+ * The coin tosses come from a generator seeded from rand().
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ */
+void riffle_indexed(void *L, size_t len, size_t size, int N) {
+    Rng rng;
+    rng_seed_from_rand(&rng);
+    riffle_indexed_r(L, len, size, N, &rng);
+}
+
 
 
 /*
@@ -117,58 +376,104 @@ do we need to check both ways?).
     so We need to check both ways because while the shuffled array should contain all the elements from the original array, 
     it is possible that the original array may contain elements that are not in the shuffled array. 
     Checking both ways ensures that we are not missing any elements in either array.
+>   Sorting copies of both arrays and comparing them element by element does both directions at once
+    and also counts duplicates: {1, 1, 2} and {1, 2, 2} pass the two "found" scans but are not the same multiset.
 */
 
 
+/**
+ * Checks whether two arrays hold the same multiset of elements.
+ * Copies of both arrays are sorted with cmp and compared pairwise, which takes O(len log len)
+ * comparisons instead of the O(len^2) of searching one array for every element of the other,
+ * and counts repeated elements correctly.
+ * @param original The array before shuffling.
+ * @param shuffled The array after shuffling.
+ * @param len The length of both arrays.
+ * @param size The size of each element in bytes.
+ * @param cmp The comparison function, which must define a total order on the elements.
+ * @return 1 if shuffled is a permutation of original, 0 otherwise.
+ */
+int check_permutation(const void *original, const void *shuffled, size_t len, size_t size, int (*cmp)(const void *, const void *)) {
+    if (len == 0) {
+        return 1;
+    }
+    char *sorted = malloc(2 * len * size); // one block holding both sorted copies
+    if (sorted == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    char *sorted_original = sorted;
+    char *sorted_shuffled = sorted + len * size;
+    memcpy(sorted_original, original, len * size);
+    memcpy(sorted_shuffled, shuffled, len * size);
+    qsort(sorted_original, len, size, cmp);
+    qsort(sorted_shuffled, len, size, cmp);
+
+    int same = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (cmp(sorted_original + i * size, sorted_shuffled + i * size) != 0) {
+            same = 0;
+            break;
+        }
+    }
+
+    free(sorted);
+    return same;
+}
+
 /**
  * Checks whether the shuffled array contains all elements of the original array and vice versa.
+ * A copy of L is shuffled with riffle_r and compared against L with check_permutation.
+ * @param L The original array.
+ * @param len The length of the array.
+ * @param size The size of each element in bytes.
+ * @param cmp The comparison function to compare two elements.
+ * @param rng The random number generator used to shuffle the copy.
+ * @return 1 if the shuffle is correct, 0 otherwise.
+ */
+int check_shuffle_r(void *L, size_t len, size_t size, int (*cmp)(const void *, const void *), Rng *rng) {
+    return check_shuffle_algorithm(&shuffle_riffle, L, len, size, 5, cmp, rng);
+}
+
+/**
+ * Checks whether a copy of L shuffled by algo contains all elements of L and vice versa.
+ * @param algo The shuffle algorithm.
  * @param L The original array.
  * @param len The length of the array.
  * @param size The size of each element in bytes.
+ * @param N The number of passes of the algorithm.
  * @param cmp The comparison function to compare two elements.
+ * @param rng The random number generator used to shuffle the copy.
  * @return 1 if the shuffle is correct, 0 otherwise.
  */
-int check_shuffle(void *L, int len, int size, int (*cmp)(void *, void *)) {
+int check_shuffle_algorithm(const ShuffleAlgorithm *algo, void *L, size_t len, size_t size, int N, int (*cmp)(const void *, const void *), Rng *rng) {
     void *shuffled = malloc(len * size);
     if (shuffled == NULL) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         exit(EXIT_FAILURE);
     }
     memcpy(shuffled, L, len * size); // Make a copy of the original array
-    riffle(shuffled, len, size, 5); // Shuffle the copied array
-
-    // Check that all elements in the original array are in the shuffled array
-    for (int i = 0; i < len; i++) {
-        int found = 0;
-        for (int j = 0; j < len; j++) {
-            if (cmp((char *) L + i * size, (char *) shuffled + j * size) == 0) {
-                found = 1;
-                break;
-            }
-        }
-        if (!found) {
-            free(shuffled);
-            return 0;
-        }
-    }
+    algo->shuffle(shuffled, len, size, N, rng); // Shuffle the copied array
 
-    // Check that all elements in the shuffled array are in the original array
-    for (int i = 0; i < len; i++) {
-        int found = 0;
-        for (int j = 0; j < len; j++) {
-            if (cmp((char *) shuffled + i * size, (char *) L + j * size) == 0) {
-                found = 1;
-                break;
-            }
-        }
-        if (!found) {
-            free(shuffled);
-            return 0;
-        }
-    }
+    int result = check_permutation(L, shuffled, len, size, cmp);
 
     free(shuffled);
-    return 1;
+    return result;
+}
+
+/**
+ * Checks whether the shuffled array contains all elements of the original array and vice versa,
+ * shuffling with a generator seeded from rand().
+ * @param L The original array.
+ * @param len The length of the array.
+ * @param size The size of each element in bytes.
+ * @param cmp The comparison function to compare two elements.
+ * @return 1 if the shuffle is correct, 0 otherwise.
+ */
+int check_shuffle(void *L, size_t len, size_t size, int (*cmp)(const void *, const void *)) {
+    Rng rng;
+    rng_seed_from_rand(&rng);
+    return check_shuffle_r(L, len, size, cmp, &rng);
 }
 
 
@@ -183,55 +488,259 @@ int check_shuffle(void *L, int len, int size, int (*cmp)(void *, void *)) {
  * @return The quality of the shuffle as a float between 0 and 1
  */
 float quality(int *numbers, int len) {
-    int count = 0;
-    for (int i = 0; i < len - 1; i++) {
-        if (numbers[i + 1] > numbers[i]) {
-            count++;
+    return (float) perm_count_ascents(numbers, len) / (len - 1); //len-1 because total no. of pairs will be 1 less than the length of array
+}
+
+
+/** Number of trials in a block; every block gets its own random number stream. */
+#define QUALITY_BLOCK 1024
+
+/**
+ * @brief The trials of one call of average_quality_algorithm, shared by its worker threads.
+ */
+typedef struct {
+    const ShuffleAlgorithm *algo; /**< The shuffle algorithm. */
+    int N;              /**< Number of integers to shuffle. */
+    int shuffles;       /**< Number of riffles per trial. */
+    long trials;        /**< Number of trials. */
+    long blocks;        /**< Number of blocks of QUALITY_BLOCK trials (the last may be shorter). */
+    long next_block;    /**< The next block to claim, taken with an atomic add. */
+    const Rng *streams; /**< Random number stream of every block. */
+    double *means;      /**< Mean trial quality of every block. */
+    double *m2s;        /**< Sum of squared deviations from the mean of every block. */
+} QualityJob;
+
+/**
+ * @brief One worker thread of average_quality_algorithm.
+ */
+typedef struct {
+    QualityJob *job;    /**< The trials to share out. */
+    ShuffleMetrics *metrics; /**< Accumulator private to this worker, or NULL. */
+    int failed;         /**< Set if the worker could not allocate its arrays. */
+} QualityWorker;
+
+/**
+ * Runs blocks of trials until none are left. Every trial starts again from the identity array
+ * 0, 1, ..., N-1, and every block draws from its own stream, so the results of a block do not
+ * depend on which thread ran it.
+ * @param arg Pointer to the QualityWorker to run.
+ * @return NULL.
+ */
+static void *quality_worker(void *arg) {
+    QualityWorker *w = arg;
+    QualityJob *job = w->job;
+    int N = job->N;
+    int *numbers = malloc(N * sizeof(int));
+    int *work = malloc(N * sizeof(int));
+    if (numbers == NULL || work == NULL) {
+        free(numbers);
+        free(work);
+        w->failed = 1;
+        return NULL;
+    }
+
+    long block;
+    while ((block = __atomic_fetch_add(&job->next_block, 1, __ATOMIC_RELAXED)) < job->blocks) {
+        Rng rng = job->streams[block];
+        long first = block * QUALITY_BLOCK;
+        long last = first + QUALITY_BLOCK < job->trials ? first + QUALITY_BLOCK : job->trials;
+        double mean = 0.0, m2 = 0.0;
+        for (long t = first; t < last; t++) {
+            for (int i = 0; i < N; i++) {
+                numbers[i] = i;
+            }
+            const int *result = numbers;
+            long ascents;
+            if (job->algo == &shuffle_riffle && job->shuffles > 0) {
+                // Alternate between the two arrays instead of copying back, and count the ascents
+                // while the last riffle writes its output
+                int *src = numbers, *dst = work;
+                for (int s = 1; s < job->shuffles; s++) {
+                    riffle_into(src, dst, N, sizeof(int), &rng);
+                    int *swap = src;
+                    src = dst;
+                    dst = swap;
+                }
+                ascents = riffle_into_ascents(src, dst, N, &rng);
+                result = dst;
+            } else {
+                if (job->algo != &shuffle_riffle) {
+                    job->algo->shuffle(numbers, N, sizeof(int), job->shuffles, &rng);
+                }
+                ascents = perm_count_ascents(numbers, N);
+            }
+            double q = (double) ascents / (N - 1);
+            // Welford's update: no sum of squares, so no cancellation when the variance is small
+            double delta = q - mean;
+            mean += delta / (t - first + 1);
+            m2 += delta * (q - mean);
+            if (w->metrics != NULL) {
+                metrics_add(w->metrics, result);
+            }
         }
+        job->means[block] = mean;
+        job->m2s[block] = m2;
     }
-    return (float) count / (len - 1); //len-1 because total no. of pairs will be 1 less than the length of array
+
+    free(numbers);
+    free(work);
+    return NULL;
 }
 
+/**
+ * Estimates the quality of riffling the integers 0, 1, ..., N-1 shuffles times, running
+ * independent trials on several threads.
+ *
+ * The trials are cut into blocks of QUALITY_BLOCK, and block k draws from the k-th stream split
+ * off the seed; threads claim blocks one at a time, and the per-block means and sums of squared
+ * deviations are merged in block order once they have finished, so the result depends on the seed
+ * but not on the number of threads. The confidence interval is the
+ * normal approximation mean +/- 1.96 standard errors.
+ *
+ * If metrics is not NULL every worker also feeds its trials into a private copy of it, and the
+ * copies are merged into metrics at the end.
+ *
+ * @param N The number of integers to shuffle (at least 2).
+ * @param shuffles The number of times to riffle the array in each trial.
+ * @param trials The number of independent trials.
+ * @param threads The number of worker threads, or 0 to use one per online CPU.
+ * @param seed Seed of the generator; every block of trials gets its own stream split off from it.
+ * @param metrics An accumulator initialised with metrics_init for length N, or NULL.
+ * @return The mean quality, its standard deviation and 95% confidence interval.
+ */
+QualityStats average_quality_stats(int N, int shuffles, long trials, int threads, uint64_t seed, ShuffleMetrics *metrics) {
+    return average_quality_algorithm(&shuffle_riffle, N, shuffles, trials, threads, seed, metrics);
+}
 
 /**
- * Evaluates the average quality of a shuffle of the integers 0, 1, ..., N-1, using riffle to shuffle the array shuffles times.
+ * Estimates the quality of shuffling the integers 0, 1, ..., N-1 with algo, running independent
+ * trials on several threads; see average_quality_stats.
  *
- * @param N The number of integers to shuffle.
- * @param shuffles The number of times to shuffle the array using riffle.
- * @param trials The number of trials to average the quality over.
- * @return The average quality of the shuffle.
+ * @param algo The shuffle algorithm; every trial calls it once with N = shuffles.
+ * @param N The number of integers to shuffle (at least 2).
+ * @param shuffles The number of passes of the algorithm in each trial.
+ * @param trials The number of independent trials.
+ * @param threads The number of worker threads, or 0 to use one per online CPU.
+ * @param seed Seed of the generator; every block of trials gets its own stream split off from it.
+ * @param metrics An accumulator initialised with metrics_init for length N, or NULL.
+ * @return The mean quality, its standard deviation and 95% confidence interval.
  */
-float average_quality(int N, int shuffles, int trials) {
-    // Allocate memory for an array of N integers
-    int *numbers = (int *) malloc(N * sizeof(int));
-    if (numbers == NULL) {
+QualityStats average_quality_algorithm(const ShuffleAlgorithm *algo, int N, int shuffles, long trials, int threads, uint64_t seed, ShuffleMetrics *metrics) {
+    QualityStats stats = {0.0, 0.0, 0.0, 0.0, 0};
+    if (N < 2 || trials <= 0) {
+        return stats;
+    }
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    QualityJob job;
+    job.algo = algo;
+    job.N = N;
+    job.shuffles = shuffles;
+    job.trials = trials;
+    job.blocks = (trials + QUALITY_BLOCK - 1) / QUALITY_BLOCK;
+    job.next_block = 0;
+    if (threads > job.blocks) {
+        threads = (int) job.blocks;
+    }
+
+    Rng *streams = malloc(job.blocks * sizeof(Rng));
+    job.means = malloc(job.blocks * sizeof(double));
+    job.m2s = malloc(job.blocks * sizeof(double));
+    QualityWorker *workers = calloc(threads, sizeof(QualityWorker));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    ShuffleMetrics *worker_metrics = metrics != NULL ? calloc(threads, sizeof(ShuffleMetrics)) : NULL;
+    if (streams == NULL || job.means == NULL || job.m2s == NULL || workers == NULL || tids == NULL
+            || (metrics != NULL && worker_metrics == NULL)) {
         fprintf(stderr, "Memory allocation failed\n");
         exit(EXIT_FAILURE);
     }
-    
-    // Initialize the array with values 0 to N-1
-    for (int i = 0; i < N; i++) {
-        numbers[i] = i;
+
+    // Block k always gets the k-th stream, whatever the number of threads
+    Rng rng;
+    rng_seed(&rng, seed);
+    for (long k = 0; k < job.blocks; k++) {
+        rng_split(&rng, &streams[k]);
+    }
+    job.streams = streams;
+    for (int t = 0; t < threads; t++) {
+        workers[t].job = &job;
+        if (metrics != NULL) {
+            if (metrics_init(&worker_metrics[t], N, metrics->cells, metrics->bins) != 0) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+            workers[t].metrics = &worker_metrics[t];
+        }
+    }
+    // Worker 0 runs on the calling thread
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, quality_worker, &workers[t]) != 0) {
+            fprintf(stderr, "Error: failed to create worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    quality_worker(&workers[0]);
+    for (int t = 1; t < threads; t++) {
+        pthread_join(tids[t], NULL);
     }
 
-    // Initialize the total quality as 0
-    float total_quality = 0.0;
-    // Perform the riffle shuffle and quality calculation trials times
-    for (int i = 0; i < trials; i++) {
-        riffle(numbers, N, sizeof(int), shuffles);
-        float q = quality(numbers, N);
-        total_quality += q;
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].failed) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        if (metrics != NULL) {
+            metrics_merge(metrics, &worker_metrics[t]);
+            metrics_free(&worker_metrics[t]);
+        }
     }
+    // Merge the blocks in order (Chan et al.), so the rounding does not depend on the threads either
+    double mean = 0.0, m2 = 0.0;
+    long count = 0;
+    for (long k = 0; k < job.blocks; k++) {
+        long n = k + 1 < job.blocks ? QUALITY_BLOCK : trials - k * QUALITY_BLOCK;
+        double delta = job.means[k] - mean;
+        count += n;
+        mean += delta * n / count;
+        m2 += job.m2s[k] + delta * delta * (double) (count - n) * n / count;
+    }
+    free(worker_metrics);
+    free(workers);
+    free(tids);
+    free(streams);
+    free(job.means);
+    free(job.m2s);
 
-    // Free the allocated memory
-    free(numbers);
+    stats.trials = trials;
+    stats.mean = mean;
+    if (trials > 1) {
+        stats.std_dev = sqrt(m2 / (trials - 1));
+    }
+    double half_width = 1.96 * stats.std_dev / sqrt((double) trials);
+    stats.ci_low = stats.mean - half_width;
+    stats.ci_high = stats.mean + half_width;
+    return stats;
+}
 
-    // Calculate the average quality over all trials and return it
-    return total_quality / trials;
+/**
+ * Evaluates the average quality of a shuffle of the integers 0, 1, ..., N-1, using riffle to shuffle the array shuffles times.
+ *
+ * @param N The number of integers to shuffle.
+ * @param shuffles The number of times to shuffle the array using riffle.
+ * @param trials The number of trials to average the quality over.
+ * @return The average quality of the shuffle.
+ */
+float average_quality(int N, int shuffles, int trials) {
+    // Seed the workers from rand() so srand() keeps controlling reproducibility
+    QualityStats stats = average_quality_stats(N, shuffles, trials, 0, seed_from_rand(), NULL);
+    return (float) stats.mean;
 }
 
 /* Instructions for running the program:
  * To compile the program, run the following command in the terminal:
  * gcc -c riffle.c -o riffle.o 
- * this function implements riffle_once, riffle, check_shuffle, cmp_int, cmp_str, quality, average_quality functions. 
+ * Programs using riffle.o must be linked with shuffles.o, metrics.o, perm_stats.o, rng.o, -pthread and -lm.
+ * this function implements riffle_into, riffle_into_ascents, riffle_once_r, riffle_once, riffle_r, riffle, riffle_indexed_r, riffle_indexed_into_r, riffle_indexed, check_permutation, check_shuffle_r, check_shuffle_algorithm, check_shuffle, cmp_int, cmp_str, quality, average_quality_stats, average_quality_algorithm, average_quality functions. 
  */
\ No newline at end of file
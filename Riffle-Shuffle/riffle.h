@@ -6,7 +6,49 @@
 #ifndef RIFFLE_H_
 #define RIFFLE_H_
 
+#include <stdint.h>
 #include <stdlib.h>
+#include "metrics.h"
+#include "rng.h"
+
+/**
+ * @brief Result of a Monte Carlo estimate of shuffle quality.
+ */
+typedef struct {
+    double mean;     /**< Mean quality over all trials. */
+    double std_dev;  /**< Sample standard deviation of the per-trial quality. */
+    double ci_low;   /**< Lower bound of the 95% confidence interval for the mean. */
+    double ci_high;  /**< Upper bound of the 95% confidence interval for the mean. */
+    long trials;     /**< Number of trials the estimate is based on. */
+} QualityStats;
+
+/**
+ * @brief A shuffle algorithm behind a common interface, so that quality and correctness checks
+ * can be run against any of them.
+ */
+typedef struct {
+    const char *name;   /**< Short name, e.g. "riffle" or "fisher_yates". */
+    /** Shuffles len elements of size bytes at L with N passes, drawing randomness from rng. */
+    void (*shuffle)(void *L, size_t len, size_t size, int N, Rng *rng);
+    int uses_passes;    /**< 1 if N matters; 0 if one call already gives a uniform permutation and N is ignored. */
+} ShuffleAlgorithm;
+
+extern const ShuffleAlgorithm shuffle_riffle;          /**< N riffles (riffle_r). */
+extern const ShuffleAlgorithm shuffle_fisher_yates;    /**< Fisher-Yates; uniform, but random access over the whole array. */
+extern const ShuffleAlgorithm shuffle_merge;           /**< Cache-blocked merge shuffle; uniform, sequential access. */
+extern const ShuffleAlgorithm shuffle_merge_parallel;  /**< Merge shuffle with the blocks and merges spread over one thread per CPU. */
+extern const ShuffleAlgorithm shuffle_overhand;        /**< N overhand shuffles. */
+
+/** All shuffle algorithms, terminated by NULL. */
+extern const ShuffleAlgorithm *const shuffle_algorithms[];
+
+/**
+ * @brief Looks up a shuffle algorithm by name.
+ *
+ * @param name The name of the algorithm.
+ * @return The algorithm, or NULL if there is none with that name.
+ */
+const ShuffleAlgorithm *shuffle_algorithm_find(const char *name);
 
 /**
  * @brief Compares two integers.
@@ -20,42 +62,182 @@ int cmp_int(const void *a, const void *b);
 /**
  * @brief Compares two strings.
  *
- * @param a Pointer to the first string.
- * @param b Pointer to the second string.
- * @return -1 if the first string is less than the second, 0 if they are equal, or 1 if the first string is greater than the second.
+ * @param a Pointer to the first string (a char ** into an array of strings).
+ * @param b Pointer to the second string (a char ** into an array of strings).
+ * @return A negative value if the first string is less than the second, 0 if they are equal, or a positive value if the first string is greater than the second.
  */
 int cmp_str(const void *a, const void *b);
 
+/**
+ * @brief Shuffles an array by performing N riffles, drawing coin tosses from rng.
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ */
+void riffle_r(void *L, size_t len, size_t size, int N, Rng *rng);
+
 /**
  * @brief Shuffles an array by performing N riffles.
  *
+ * Equivalent to riffle_r with a generator seeded from rand().
+ *
  * @param L Pointer to the array to shuffle.
  * @param len Length of the array.
  * @param size Size of each element in the array.
  * @param N Number of riffles to perform.
  */
-void riffle(void *L, int len, int size, int N);
+void riffle(void *L, size_t len, size_t size, int N);
+
+/**
+ * @brief Shuffles an array by performing N riffles on an index array and moving each element once.
+ *
+ * For large elements this costs N passes over 4-byte (or, beyond 2^32 elements, 8-byte) indices
+ * plus one pass over the payload, instead of N passes over the payload. The permutation is applied
+ * in place by following its cycles. The result equals riffle_r with the same generator state.
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ */
+void riffle_indexed_r(void *L, size_t len, size_t size, int N, Rng *rng);
+
+/**
+ * @brief Writes a copy of src shuffled by N riffles to dst, riffling an index array and moving each element once.
+ *
+ * @param src Pointer to the array to shuffle; it is not modified.
+ * @param dst Pointer to an array of the same size as src receiving the result.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ */
+void riffle_indexed_into_r(const void *src, void *dst, size_t len, size_t size, int N, Rng *rng);
+
+/**
+ * @brief Shuffles an array by performing N riffles on an index array and moving each element once.
+ *
+ * Equivalent to riffle_indexed_r with a generator seeded from rand().
+ *
+ * @param L Pointer to the array to shuffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of riffles to perform.
+ */
+void riffle_indexed(void *L, size_t len, size_t size, int N);
+
+/**
+ * @brief Performs one riffle of src into dst, drawing coin tosses from rng.
+ *
+ * This is the kernel of riffle_once_r without the copy back, so callers that alternate
+ * between two buffers (such as riffle_file_mmap) save one pass per riffle.
+ *
+ * @param src Pointer to the array to riffle; it is not modified.
+ * @param dst Pointer to an array of the same size as src receiving the result.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ */
+void riffle_into(const void *src, void *dst, size_t len, size_t size, Rng *rng);
+
+/**
+ * @brief Performs one riffle of an int array from src into dst and counts the ascents of the result.
+ *
+ * Consumes rng exactly like riffle_into, so the two produce the same dst, but the quality of dst
+ * is measured while it is written instead of in a second pass.
+ *
+ * @param src Pointer to the array to riffle; it is not modified.
+ * @param dst Pointer to an array of the same length as src receiving the result.
+ * @param len Length of the array.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ * @return The number of adjacent ascents dst[k] < dst[k + 1].
+ */
+long riffle_into_ascents(const int *src, int *dst, size_t len, Rng *rng);
+
+/**
+ * @brief Performs one riffle operation on an array, drawing coin tosses from rng.
+ *
+ * @param L Pointer to the array to riffle.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param work Pointer to a work array of the same size as L.
+ * @param rng Random number generator, e.g. seeded with rng_seed.
+ */
+void riffle_once_r(void *L, size_t len, size_t size, void *work, Rng *rng);
 
 /**
  * @brief Performs one riffle operation on an array.
  *
+ * Equivalent to riffle_once_r with a generator seeded from rand().
+ *
  * @param L Pointer to the array to riffle.
  * @param len Length of the array.
  * @param size Size of each element in the array.
  * @param work Pointer to a work array of the same size as L.
  */
-void riffle_once(void *L, int len, int size, void *work);
+void riffle_once(void *L, size_t len, size_t size, void *work);
+
+/**
+ * @brief Checks that one array is a permutation of another.
+ *
+ * Sorts copies of both arrays with cmp and compares them, so it runs in O(len log len)
+ * and takes repeated elements into account.
+ *
+ * @param original Pointer to the array before shuffling.
+ * @param shuffled Pointer to the array after shuffling.
+ * @param len Length of both arrays.
+ * @param size Size of each element in the arrays.
+ * @param cmp Function defining a total order on the elements.
+ * @return 1 if both arrays hold the same multiset of elements, 0 otherwise.
+ */
+int check_permutation(const void *original, const void *shuffled, size_t len, size_t size, int (*cmp)(const void *, const void *));
+
+/**
+ * @brief Checks that an array has been properly shuffled, riffling with rng.
+ *
+ * Riffles a copy of L and verifies it with check_permutation.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param cmp Function to compare two elements in the array.
+ * @param rng Random number generator used to riffle the copy.
+ * @return 1 if the array has been properly shuffled, 0 otherwise.
+ */
+int check_shuffle_r(void *L, size_t len, size_t size, int (*cmp)(const void *, const void *), Rng *rng);
+
+/**
+ * @brief Checks that a shuffle algorithm permutes an array properly.
+ *
+ * Shuffles a copy of L with algo and N passes and verifies it with check_permutation.
+ *
+ * @param algo The shuffle algorithm.
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element in the array.
+ * @param N Number of passes of the algorithm.
+ * @param cmp Function to compare two elements in the array.
+ * @param rng Random number generator used to shuffle the copy.
+ * @return 1 if the array has been properly shuffled, 0 otherwise.
+ */
+int check_shuffle_algorithm(const ShuffleAlgorithm *algo, void *L, size_t len, size_t size, int N, int (*cmp)(const void *, const void *), Rng *rng);
 
 /**
  * @brief Checks that an array has been properly shuffled.
  *
- * @param L Pointer to the shuffled array.
+ * Equivalent to check_shuffle_r with a generator seeded from rand().
+ *
+ * @param L Pointer to the array.
  * @param len Length of the array.
  * @param size Size of each element in the array.
  * @param cmp Function to compare two elements in the array.
  * @return 1 if the array has been properly shuffled, 0 otherwise.
  */
-int check_shuffle(void *L, int len, int size, int (*cmp)(const void *, const void *));
+int check_shuffle(void *L, size_t len, size_t size, int (*cmp)(const void *, const void *));
 
 /**
  * Calculate the quality of a shuffle
@@ -66,6 +248,41 @@ int check_shuffle(void *L, int len, int size, int (*cmp)(const void *, const voi
  */
 float quality(int *numbers, int len);
 
+/**
+ * Estimate the quality of a shuffle with independent trials run in parallel
+ *
+ * Every trial riffles a fresh copy of 0, 1, ..., N-1. The trials run in blocks, each drawing from
+ * its own random number stream, which worker threads claim one at a time; every block keeps the
+ * mean and squared deviations of its qualities (Welford's method), and the blocks are merged in
+ * order, so the same seed gives the same result with any number of threads.
+ *
+ * @param N the number of integers to shuffle (at least 2)
+ * @param shuffles the number of times to riffle the array in each trial
+ * @param trials the number of trials
+ * @param threads the number of worker threads, or 0 for one per online CPU
+ * @param seed seed of the generator; each block of trials gets its own stream split off with rng_split, so the result does not depend on threads
+ * @param metrics if not NULL, an accumulator from metrics_init(metrics, N, ...) that receives every trial
+ * @return the mean quality together with its standard deviation and 95% confidence interval
+ */
+QualityStats average_quality_stats(int N, int shuffles, long trials, int threads, uint64_t seed, ShuffleMetrics *metrics);
+
+/**
+ * Estimate the quality of any shuffle algorithm with independent trials run in parallel
+ *
+ * Like average_quality_stats, which is this function with shuffle_riffle, but every trial
+ * shuffles with algo->shuffle(numbers, N, sizeof(int), shuffles, rng).
+ *
+ * @param algo the shuffle algorithm
+ * @param N the number of integers to shuffle (at least 2)
+ * @param shuffles the number of passes of the algorithm in each trial
+ * @param trials the number of trials
+ * @param threads the number of worker threads, or 0 for one per online CPU
+ * @param seed seed of the generator; each block of trials gets its own stream split off with rng_split, so the result does not depend on threads
+ * @param metrics if not NULL, an accumulator from metrics_init(metrics, N, ...) that receives every trial
+ * @return the mean quality together with its standard deviation and 95% confidence interval
+ */
+QualityStats average_quality_algorithm(const ShuffleAlgorithm *algo, int N, int shuffles, long trials, int threads, uint64_t seed, ShuffleMetrics *metrics);
+
 /**
  * Calculate the average quality of a shuffle
  *
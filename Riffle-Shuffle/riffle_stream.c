@@ -0,0 +1,348 @@
+/**
+*
+* @file riffle_stream.c
+* @brief This program implements the riffle shuffle of a file of fixed-size records that may be larger than memory.
+* riffle() needs the whole array plus a work array of the same size in memory. riffle_file instead treats a file
+* as the array: the first half is read through one buffered reader and the second half through another, and the
+* records are interleaved into a second file through a buffered writer. All three streams are sequential, so every
+* pass runs at close to the sequential bandwidth of the disk while holding only three buffers in memory.
+* riffle_file_mmap does the same passes over two memory-mapped files, leaving the paging to the kernel.
+* @author Josh
+* @bug No known bugs.
+*/
+#define _POSIX_C_SOURCE 200809L /* fseeko, clock_gettime, mmap */
+#define _DEFAULT_SOURCE /* madvise */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include "riffle.h"
+#include "riffle_stream.h"
+
+/**
+ * @brief A buffered reader handing out consecutive records of one half of a file.
+ */
+typedef struct {
+    FILE *fp;            /**< The file, positioned at the next unbuffered record. */
+    char *buf;           /**< Buffer holding whole records. */
+    size_t cap;          /**< Capacity of buf in records. */
+    size_t pos;          /**< Index of the next record in buf. */
+    size_t end;          /**< Number of records in buf. */
+    uint64_t unread;     /**< Records of this half not yet read into buf. */
+} RecordReader;
+
+/**
+ * @brief Returns the time of a monotonic clock in seconds.
+ *
+ * @return The time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Refills a reader's buffer with the next records of its half.
+ *
+ * @param r The reader.
+ * @param record_size The size of each record in bytes.
+ * @return 0 on success, -1 on a read error or premature end of file.
+ */
+static int reader_fill(RecordReader *r, size_t record_size) {
+    size_t want = r->unread < r->cap ? (size_t) r->unread : r->cap;
+    size_t got = fread(r->buf, record_size, want, r->fp);
+    if (got != want) {
+        return -1;
+    }
+    r->pos = 0;
+    r->end = got;
+    r->unread -= got;
+    return 0;
+}
+
+/**
+ * @brief Runs one riffle pass from src to dst.
+ *
+ * @param src The file to read.
+ * @param dst The file to write; it is truncated first.
+ * @param len The number of records in src.
+ * @param record_size The size of each record in bytes.
+ * @param cap The capacity of each buffer in records.
+ * @param bufs Three buffers of cap records: left reader, right reader and writer.
+ * @param rng The random number generator used for the coin tosses.
+ * @return 0 on success, -1 on failure (a message is printed to stderr).
+ */
+static int riffle_file_pass(const char *src, const char *dst, uint64_t len, size_t record_size,
+                            size_t cap, char *bufs[3], Rng *rng) {
+    uint64_t half = len / 2;
+    FILE *left_fp = fopen(src, "rb");
+    FILE *right_fp = fopen(src, "rb");
+    FILE *out_fp = fopen(dst, "wb");
+    int status = -1;
+    if (left_fp == NULL || right_fp == NULL || out_fp == NULL) {
+        fprintf(stderr, "Error: cannot open %s or %s: %s\n", src, dst, strerror(errno));
+        goto done;
+    }
+    // Our buffers are already large, so stdio's own buffering would only add a copy
+    setvbuf(left_fp, NULL, _IONBF, 0);
+    setvbuf(right_fp, NULL, _IONBF, 0);
+    setvbuf(out_fp, NULL, _IONBF, 0);
+    if (fseeko(right_fp, (off_t) (half * record_size), SEEK_SET) != 0) {
+        fprintf(stderr, "Error: cannot seek in %s: %s\n", src, strerror(errno));
+        goto done;
+    }
+
+    RecordReader left = {left_fp, bufs[0], cap, 0, 0, half};
+    RecordReader right = {right_fp, bufs[1], cap, 0, 0, len - half};
+    char *out = bufs[2];
+    size_t out_count = 0;
+
+    for (uint64_t k = 0; k < len; k++) {
+        int left_has = left.pos < left.end || left.unread > 0;
+        int right_has = right.pos < right.end || right.unread > 0;
+        // Toss a coin while both hands have records, then drain whichever is left
+        RecordReader *r = (left_has && (!right_has || rng_bit(rng))) ? &left : &right;
+        if (r->pos == r->end && reader_fill(r, record_size) != 0) {
+            fprintf(stderr, "Error: failed to read %s\n", src);
+            goto done;
+        }
+        memcpy(out + out_count * record_size, r->buf + r->pos * record_size, record_size);
+        r->pos++;
+        if (++out_count == cap) {
+            if (fwrite(out, record_size, out_count, out_fp) != out_count) {
+                fprintf(stderr, "Error: failed to write %s\n", dst);
+                goto done;
+            }
+            out_count = 0;
+        }
+    }
+    if (out_count > 0 && fwrite(out, record_size, out_count, out_fp) != out_count) {
+        fprintf(stderr, "Error: failed to write %s\n", dst);
+        goto done;
+    }
+    status = 0;
+
+done:
+    if (left_fp != NULL) fclose(left_fp);
+    if (right_fp != NULL) fclose(right_fp);
+    if (out_fp != NULL && fclose(out_fp) != 0 && status == 0) {
+        fprintf(stderr, "Error: failed to write %s\n", dst);
+        status = -1;
+    }
+    return status;
+}
+
+/**
+ * @brief Returns the name of the scratch file used for path.
+ *
+ * @param path The file being shuffled.
+ * @return A newly allocated string, path followed by ".riffle-tmp".
+ */
+static char *scratch_name(const char *path) {
+    char *scratch = malloc(strlen(path) + sizeof(".riffle-tmp"));
+    if (scratch == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(scratch, path);
+    strcat(scratch, ".riffle-tmp");
+    return scratch;
+}
+
+/**
+ * @brief Riffles a file of fixed-size records N times using bounded memory.
+ *
+ * @param path The file to shuffle; its size must be a multiple of record_size.
+ * @param record_size The size of each record in bytes.
+ * @param N The number of riffles to perform.
+ * @param buffer_size The size of each I/O buffer in bytes (rounded down to whole records, at least one).
+ * @param rng The random number generator used for the coin tosses.
+ * @param passes If not NULL, an array of N entries that receives the timing of every pass.
+ * @return 0 on success, -1 on failure (a message is printed to stderr).
+ */
+int riffle_file(const char *path, size_t record_size, int N, size_t buffer_size, Rng *rng, RiffleFilePass *passes) {
+    struct stat st;
+    if (record_size == 0 || stat(path, &st) != 0) {
+        fprintf(stderr, "Error: cannot stat %s\n", path);
+        return -1;
+    }
+    if ((uint64_t) st.st_size % record_size != 0) {
+        fprintf(stderr, "Error: size of %s is not a multiple of the record size %zu\n", path, record_size);
+        return -1;
+    }
+    uint64_t len = (uint64_t) st.st_size / record_size;
+    if (N <= 0 || len < 2) {
+        return 0;
+    }
+
+    size_t cap = buffer_size / record_size;
+    if (cap == 0) {
+        cap = 1;
+    }
+    char *bufs[3];
+    bufs[0] = malloc(3 * cap * record_size); // one block for both readers and the writer
+    if (bufs[0] == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    bufs[1] = bufs[0] + cap * record_size;
+    bufs[2] = bufs[1] + cap * record_size;
+
+    char *scratch = scratch_name(path);
+
+    int status = 0;
+    const char *src = path;
+    const char *dst = scratch;
+    for (int i = 0; i < N; i++) {
+        double started = now_seconds();
+        if (riffle_file_pass(src, dst, len, record_size, cap, bufs, rng) != 0) {
+            status = -1;
+            break;
+        }
+        double seconds = now_seconds() - started;
+        if (passes != NULL) {
+            passes[i].seconds = seconds;
+            passes[i].mb_per_s = seconds > 0 ? st.st_size / 1e6 / seconds : 0.0;
+        }
+        const char *tmp = src; // the output of this pass is the input of the next
+        src = dst;
+        dst = tmp;
+    }
+
+    // src holds the last complete pass, even if a later pass failed half way through writing dst
+    if (src == scratch) {
+        chmod(scratch, st.st_mode & 07777); // keep path's permissions; failing only loses them
+        if (rename(scratch, path) != 0) {
+            fprintf(stderr, "Error: cannot rename %s to %s: %s\n", scratch, path, strerror(errno));
+            status = -1;
+        }
+    } else {
+        remove(scratch);
+    }
+
+    free(scratch);
+    free(bufs[0]);
+    return status;
+}
+
+/**
+ * @brief Maps a whole file for reading and writing and advises the kernel how it will be used.
+ *
+ * @param fd The open file.
+ * @param bytes The size of the file.
+ * @return The mapping, or MAP_FAILED.
+ */
+static void *map_records(int fd, size_t bytes) {
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return map;
+    }
+    // Each riffle streams through both halves and the output front to back
+    posix_madvise(map, bytes, POSIX_MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(map, bytes, MADV_HUGEPAGE); // only a hint; ignored where the file system cannot use huge pages
+#endif
+    return map;
+}
+
+/**
+ * @brief Riffles a file of fixed-size records N times through memory mappings.
+ *
+ * @param path The file to shuffle; its size must be a multiple of record_size.
+ * @param record_size The size of each record in bytes.
+ * @param N The number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
+ * @param passes If not NULL, an array of N entries that receives the timing of every pass.
+ * @return 0 on success, -1 on failure (a message is printed to stderr).
+ */
+int riffle_file_mmap(const char *path, size_t record_size, int N, Rng *rng, RiffleFilePass *passes) {
+    int fd = open(path, O_RDWR);
+    struct stat st;
+    if (record_size == 0 || fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t bytes = (size_t) st.st_size;
+    if (bytes % record_size != 0) {
+        fprintf(stderr, "Error: size of %s is not a multiple of the record size %zu\n", path, record_size);
+        close(fd);
+        return -1;
+    }
+    size_t len = bytes / record_size;
+    if (N <= 0 || len < 2) {
+        close(fd);
+        return 0;
+    }
+
+    char *scratch = scratch_name(path);
+    // The scratch file may be renamed over path, so give it path's permissions rather than the umask's
+    int scratch_fd = open(scratch, O_RDWR | O_CREAT | O_TRUNC, st.st_mode & 07777);
+    if (scratch_fd < 0 || fchmod(scratch_fd, st.st_mode & 07777) != 0 || ftruncate(scratch_fd, st.st_size) != 0) {
+        fprintf(stderr, "Error: cannot create %s: %s\n", scratch, strerror(errno));
+        if (scratch_fd >= 0) close(scratch_fd);
+        close(fd);
+        remove(scratch);
+        free(scratch);
+        return -1;
+    }
+
+    void *maps[2];
+    maps[0] = map_records(fd, bytes);
+    maps[1] = map_records(scratch_fd, bytes);
+    int status = 0;
+    if (maps[0] == MAP_FAILED || maps[1] == MAP_FAILED) {
+        fprintf(stderr, "Error: cannot map %s: %s\n", path, strerror(errno));
+        status = -1;
+    } else {
+        for (int i = 0; i < N; i++) {
+            double started = now_seconds();
+            riffle_into(maps[i % 2], maps[(i + 1) % 2], len, record_size, rng);
+            double seconds = now_seconds() - started;
+            if (passes != NULL) {
+                passes[i].seconds = seconds;
+                passes[i].mb_per_s = seconds > 0 ? bytes / 1e6 / seconds : 0.0;
+            }
+        }
+        // Write the result back before the scratch file can replace path, so a crash after the rename
+        // cannot leave path pointing at pages that never reached the disk
+        if (msync(maps[N % 2], bytes, MS_SYNC) != 0) {
+            fprintf(stderr, "Error: failed to write %s: %s\n", N % 2 == 1 ? scratch : path, strerror(errno));
+            status = -1;
+        }
+    }
+    if (maps[0] != MAP_FAILED) munmap(maps[0], bytes);
+    if (maps[1] != MAP_FAILED) munmap(maps[1], bytes);
+    close(fd);
+    if (close(scratch_fd) != 0) {
+        status = -1;
+    }
+
+    // After an odd number of riffles the result is in the scratch file; after a failure path is
+    // left as it is, which after an even number of riffles is not the original (see riffle_stream.h)
+    if (status == 0 && N % 2 == 1) {
+        if (rename(scratch, path) != 0) {
+            fprintf(stderr, "Error: cannot rename %s to %s: %s\n", scratch, path, strerror(errno));
+            status = -1;
+        }
+    } else {
+        remove(scratch);
+    }
+    free(scratch);
+    return status;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c riffle_stream.c -o riffle_stream.o
+ * this file implements riffle_file and riffle_file_mmap functions.
+ */
@@ -0,0 +1,65 @@
+/**
+ * @file riffle_stream.h
+ * @brief Header file for riffle_stream.c, riffle shuffles of files that do not fit in memory.
+ *
+ * Programs using these functions must be linked with riffle.o, shuffles.o, rng.o, metrics.o and perm_stats.o.
+ */
+
+#ifndef RIFFLE_STREAM_H_
+#define RIFFLE_STREAM_H_
+
+#include <stddef.h>
+#include "rng.h"
+
+/**
+ * @brief Timing of one pass of riffle_file.
+ */
+typedef struct {
+    double seconds;      /**< Wall time of the pass. */
+    double mb_per_s;     /**< File size in megabytes (10^6 bytes) divided by seconds. */
+} RiffleFilePass;
+
+/**
+ * @brief Riffles a file of fixed-size records N times using bounded memory.
+ *
+ * Every pass reads the two halves of the current file sequentially through two buffered readers and
+ * writes the interleaved records sequentially to a second file, exactly as riffle_once does in memory;
+ * the two files then swap roles. The second file is path with ".riffle-tmp" appended, and the result
+ * always ends up in path. At most three buffers of buffer_size bytes are held in memory.
+ *
+ * @param path The file to shuffle; its size must be a multiple of record_size.
+ * @param record_size The size of each record in bytes.
+ * @param N The number of riffles to perform.
+ * @param buffer_size The size of each I/O buffer in bytes (rounded down to whole records, at least one).
+ * @param rng The random number generator used for the coin tosses.
+ * @param passes If not NULL, an array of N entries that receives the timing of every pass.
+ * @return 0 on success, -1 on failure (a message is printed to stderr).
+ */
+int riffle_file(const char *path, size_t record_size, int N, size_t buffer_size, Rng *rng, RiffleFilePass *passes);
+
+/**
+ * @brief Riffles a file of fixed-size records N times through memory mappings.
+ *
+ * The file and a scratch file of the same size (path with ".riffle-tmp" appended) are mapped into
+ * memory and the riffles alternate between the two mappings with riffle_into, so no data passes
+ * through stdio buffers and no riffle needs a copy back. Both mappings are advised as sequential
+ * (and as huge-page candidates where the system supports it). The result always ends up in path:
+ * after an odd number of riffles the scratch file, which is given path's permissions, is synced
+ * with msync and renamed over path; after an even number the last riffle writes into path's own
+ * mapping, which is synced before returning.
+ *
+ * As with riffle_file, every second pass writes into path itself, here through a shared mapping,
+ * so if the process is killed during one of them path holds part of a pass and the last complete
+ * pass is only in the scratch file; copy the file first if the original must survive an
+ * interrupted run.
+ *
+ * @param path The file to shuffle; its size must be a multiple of record_size.
+ * @param record_size The size of each record in bytes.
+ * @param N The number of riffles to perform.
+ * @param rng The random number generator used for the coin tosses.
+ * @param passes If not NULL, an array of N entries that receives the timing of every pass.
+ * @return 0 on success, -1 on failure (a message is printed to stderr).
+ */
+int riffle_file_mmap(const char *path, size_t record_size, int N, Rng *rng, RiffleFilePass *passes);
+
+#endif /* RIFFLE_STREAM_H_ */
@@ -0,0 +1,125 @@
+/**
+*
+* @file rng.c
+* @brief This program implements seeding, stream splitting and bounded draws for the xoshiro256** generator.
+* The generator itself (rng_next) and the coin toss used by the riffles (rng_bit) are inline functions in rng.h.
+* @author Josh
+* @bug No known bugs.
+*/
+#include <stdint.h>
+#include "rng.h"
+
+/**
+ * @brief Returns the next output of a SplitMix64 generator, used to expand seeds.
+ *
+ * @param x The SplitMix64 state, advanced by the call.
+ * @return The output.
+ */
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Seeds a generator.
+ *
+ * @param rng The generator to seed.
+ * @param seed The seed.
+ */
+void rng_seed(Rng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+    rng->bits = 0;
+    rng->nbits = 0;
+}
+
+/**
+ * @brief Advances a generator by 2^128 steps.
+ *
+ * @param rng The generator to advance.
+ */
+void rng_jump(Rng *rng) {
+    static const uint64_t jump[] = {
+        0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+    };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (UINT64_C(1) << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+    rng->bits = 0;
+    rng->nbits = 0;
+}
+
+/**
+ * @brief Splits off an independent stream.
+ *
+ * @param parent The generator to split.
+ * @param child The generator receiving the new stream.
+ */
+void rng_split(Rng *parent, Rng *child) {
+    *child = *parent;
+    child->bits = 0;
+    child->nbits = 0;
+    rng_jump(parent);
+}
+
+/**
+ * @brief Returns a random integer in [0, n) without modulo bias.
+ * Uses Lemire's multiply-and-reject method, which needs a division only when a draw is rejected.
+ *
+ * @param rng The generator.
+ * @param n The bound (must be positive).
+ * @return The random integer.
+ */
+uint64_t rng_below(Rng *rng, uint64_t n) {
+    if (n <= UINT32_MAX) {
+        uint64_t m = (rng_next(rng) >> 32) * n;
+        uint32_t low = (uint32_t) m;
+        if (low < n) {
+            uint32_t threshold = (uint32_t) (-(uint32_t) n) % (uint32_t) n;
+            while (low < threshold) {
+                m = (rng_next(rng) >> 32) * n;
+                low = (uint32_t) m;
+            }
+        }
+        return m >> 32;
+    }
+    // Bounds above 2^32 are rare here, so plain rejection sampling is good enough
+    uint64_t limit = UINT64_MAX - UINT64_MAX % n;
+    uint64_t x;
+    do {
+        x = rng_next(rng);
+    } while (x >= limit);
+    return x % n;
+}
+
+/**
+ * @brief Returns a random double in [0, 1).
+ *
+ * @param rng The generator.
+ * @return The random double.
+ */
+double rng_double(Rng *rng) {
+    return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c rng.c -o rng.o
+ * this file implements rng_seed, rng_jump, rng_split, rng_below, rng_double functions.
+ */
@@ -0,0 +1,109 @@
+/**
+ * @file rng.h
+ * @brief Header file for rng.c, a small seedable random number generator for the shuffles.
+ *
+ * The generator is xoshiro256** (Blackman and Vigna). Its state lives in an Rng object owned by
+ * the caller, so independent shuffles can run on different threads and every experiment can be
+ * repeated from its seed. rng_next and rng_bit are defined here so the riffle kernels can inline them.
+ */
+
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <stdint.h>
+
+/**
+ * @brief State of a xoshiro256** generator plus a buffer of unused random bits.
+ */
+typedef struct {
+    uint64_t s[4];   /**< Generator state; must not be all zero. */
+    uint64_t bits;   /**< Random bits not yet handed out by rng_bit. */
+    int nbits;       /**< Number of valid bits left in bits. */
+} Rng;
+
+/**
+ * @brief Seeds a generator.
+ *
+ * The 64-bit seed is expanded into the 256-bit state with SplitMix64, so nearby seeds such as
+ * 1, 2, 3 give unrelated sequences.
+ *
+ * @param rng The generator to seed.
+ * @param seed The seed.
+ */
+void rng_seed(Rng *rng, uint64_t seed);
+
+/**
+ * @brief Advances a generator by 2^128 steps.
+ *
+ * @param rng The generator to advance.
+ */
+void rng_jump(Rng *rng);
+
+/**
+ * @brief Splits off an independent stream.
+ *
+ * child receives the current state of parent, and parent then jumps 2^128 steps ahead, so calling
+ * rng_split repeatedly hands out non-overlapping streams, e.g. one per worker thread.
+ *
+ * @param parent The generator to split.
+ * @param child The generator receiving the new stream.
+ */
+void rng_split(Rng *parent, Rng *child);
+
+/**
+ * @brief Returns a random integer in [0, n) without modulo bias.
+ *
+ * @param rng The generator.
+ * @param n The bound (must be positive).
+ * @return The random integer.
+ */
+uint64_t rng_below(Rng *rng, uint64_t n);
+
+/**
+ * @brief Returns a random double in [0, 1).
+ *
+ * @param rng The generator.
+ * @return The random double.
+ */
+double rng_double(Rng *rng);
+
+/**
+ * @brief Returns the next 64 random bits.
+ *
+ * @param rng The generator.
+ * @return The random bits.
+ */
+static inline uint64_t rng_next(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/**
+ * @brief Returns one random bit, a fair coin toss.
+ *
+ * Bits are taken from a buffered 64-bit output, so 64 tosses cost one call to rng_next.
+ *
+ * @param rng The generator.
+ * @return 0 or 1 with equal probability.
+ */
+static inline int rng_bit(Rng *rng) {
+    if (rng->nbits == 0) {
+        rng->bits = rng_next(rng);
+        rng->nbits = 64;
+    }
+    int bit = (int) (rng->bits & 1);
+    rng->bits >>= 1;
+    rng->nbits--;
+    return bit;
+}
+
+#endif /* RNG_H_ */
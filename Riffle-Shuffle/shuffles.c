@@ -0,0 +1,414 @@
+/**
+*
+* @file shuffles.c
+* @brief This program implements a family of shuffles behind the common ShuffleAlgorithm interface of riffle.h.
+* Besides the riffle shuffle there is the Fisher-Yates shuffle, which gives a uniformly random permutation in
+* one pass but jumps all over the array; a cache-blocked merge shuffle, which Fisher-Yates shuffles blocks that
+* fit in cache and then merges them with random interleavings that keep the result uniform; a parallel version
+* of the merge shuffle; and the overhand shuffle, which is a poor mixer but a common way to shuffle cards.
+* All of them shuffle arrays of len elements of size bytes, like riffle, so the quality and check functions can
+* compare them directly.
+* @author Josh
+* @bug No known bugs.
+*/
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "riffle.h"
+#include "rng.h"
+
+/** Bytes per block of the merge shuffle; a block is Fisher-Yates shuffled while it sits in cache. */
+#define MERGE_BLOCK_BYTES (128 * 1024)
+
+/** Arrays smaller than this are merge shuffled on one thread; starting threads would cost more. */
+#define PARALLEL_MIN_BYTES (4 * 1024 * 1024)
+
+/**
+ * @brief Swaps two elements of size bytes.
+ *
+ * @param a Pointer to the first element.
+ * @param b Pointer to the second element.
+ * @param size Size of each element.
+ * @param tmp Space for one element.
+ */
+static void swap_elements(char *a, char *b, size_t size, char *tmp) {
+    memcpy(tmp, a, size);
+    memcpy(a, b, size);
+    memcpy(b, tmp, size);
+}
+
+/**
+ * @brief Returns scratch space for one element, using buf when it is large enough.
+ *
+ * @param size Size of the element.
+ * @param buf A buffer of buf_size bytes.
+ * @param buf_size Size of buf.
+ * @return buf, or newly allocated memory that must be freed.
+ */
+static char *element_tmp(size_t size, char *buf, size_t buf_size) {
+    if (size <= buf_size) {
+        return buf;
+    }
+    char *tmp = malloc(size);
+    if (tmp == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return tmp;
+}
+
+/**
+ * @brief Fisher-Yates shuffles an array with the given element scratch space.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element.
+ * @param rng The random number generator.
+ * @param tmp Space for one element.
+ */
+static void fisher_yates(char *L, size_t len, size_t size, Rng *rng, char *tmp) {
+    for (size_t i = len; i > 1; i--) {
+        size_t j = (size_t) rng_below(rng, i);
+        if (j != i - 1) {
+            swap_elements(L + (i - 1) * size, L + j * size, size, tmp);
+        }
+    }
+}
+
+/**
+ * @brief Shuffles an array uniformly with one Fisher-Yates pass; N is ignored.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element.
+ * @param N Ignored.
+ * @param rng The random number generator.
+ */
+static void shuffle_fisher_yates_r(void *L, size_t len, size_t size, int N, Rng *rng) {
+    (void) N;
+    char buf[64];
+    char *tmp = element_tmp(size, buf, sizeof(buf));
+    fisher_yates(L, len, size, rng, tmp);
+    if (tmp != buf) {
+        free(tmp);
+    }
+}
+
+/**
+ * @brief The loop of merge_random, inlined for each element size it dispatches on.
+ */
+static inline void merge_random_sized(const char *left, size_t nl, const char *right, size_t nr, char *dst, size_t size, Rng *rng) {
+    while (nl > 0 && nr > 0) {
+        size_t take_left = rng_below(rng, nl + nr) < nl; // select without a branch; the coin is unpredictable
+        memcpy(dst, take_left ? left : right, size);
+        left += take_left * size;
+        right += (1 - take_left) * size;
+        nl -= take_left;
+        nr -= 1 - take_left;
+        dst += size;
+    }
+    memcpy(dst, left, nl * size);
+    memcpy(dst + nl * size, right, nr * size);
+}
+
+/**
+ * @brief Merges two shuffled runs into dst with a uniformly random interleaving.
+ *
+ * The next element comes from the left run with probability (left remaining) / (both remaining),
+ * which makes every interleaving equally likely, so merging two uniformly shuffled runs gives a
+ * uniformly shuffled result.
+ *
+ * @param left The first run.
+ * @param nl Length of the first run.
+ * @param right The second run.
+ * @param nr Length of the second run.
+ * @param dst Destination for nl + nr elements.
+ * @param size Size of each element.
+ * @param rng The random number generator.
+ */
+static void merge_random(const char *left, size_t nl, const char *right, size_t nr, char *dst, size_t size, Rng *rng) {
+    switch (size) { // constant sizes let the compiler turn memcpy into single moves
+    case 4: merge_random_sized(left, nl, right, nr, dst, 4, rng); break;
+    case 8: merge_random_sized(left, nl, right, nr, dst, 8, rng); break;
+    default: merge_random_sized(left, nl, right, nr, dst, size, rng); break;
+    }
+}
+
+/**
+ * @brief Returns how many elements go in one merge shuffle block.
+ *
+ * @param size Size of each element.
+ * @return The block length, at least 2.
+ */
+static size_t merge_block_len(size_t size) {
+    size_t block = MERGE_BLOCK_BYTES / size;
+    return block < 2 ? 2 : block;
+}
+
+/**
+ * @brief Shuffles an array uniformly with the cache-blocked merge shuffle; N is ignored.
+ *
+ * Blocks of about MERGE_BLOCK_BYTES are Fisher-Yates shuffled, then runs are merged pairwise with
+ * merge_random, doubling the run length each level, alternating between L and a work array. Every
+ * level streams through memory sequentially.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element.
+ * @param N Ignored.
+ * @param rng The random number generator.
+ */
+static void shuffle_merge_r(void *L, size_t len, size_t size, int N, Rng *rng) {
+    (void) N;
+    size_t block = merge_block_len(size);
+    if (len <= block) {
+        shuffle_fisher_yates_r(L, len, size, 1, rng);
+        return;
+    }
+    char buf[64];
+    char *tmp = element_tmp(size, buf, sizeof(buf));
+    char *work = malloc(len * size);
+    if (work == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char *src = L;
+    char *dst = work;
+    for (size_t start = 0; start < len; start += block) {
+        size_t n = len - start < block ? len - start : block;
+        fisher_yates(src + start * size, n, size, rng, tmp);
+    }
+    for (size_t run = block; run < len; run *= 2) {
+        for (size_t start = 0; start < len; start += 2 * run) {
+            size_t mid = start + run < len ? start + run : len;
+            size_t end = start + 2 * run < len ? start + 2 * run : len;
+            merge_random(src + start * size, mid - start, src + mid * size, end - mid, dst + start * size, size, rng);
+        }
+        char *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != (char *) L) {
+        memcpy(L, src, len * size);
+    }
+
+    free(work);
+    if (tmp != buf) {
+        free(tmp);
+    }
+}
+
+/**
+ * @brief One level of the parallel merge shuffle, shared by all its worker threads.
+ */
+typedef struct {
+    char *src;           /**< Array read by this level. */
+    char *dst;           /**< Array written by this level (unused for the block level). */
+    size_t len;          /**< Length of the array. */
+    size_t size;         /**< Size of each element. */
+    size_t run;          /**< Run length merged at this level, or 0 for the block level. */
+    size_t block;        /**< Block length of the block level. */
+    size_t tasks;        /**< Number of blocks or merges at this level. */
+    int threads;         /**< Number of worker threads. */
+} MergeLevel;
+
+/**
+ * @brief A worker thread of the parallel merge shuffle.
+ */
+typedef struct {
+    const MergeLevel *level;  /**< The level being worked on. */
+    int index;                /**< This worker's number; it takes tasks index, index + threads, ... */
+    Rng rng;                  /**< Stream private to this worker. */
+} MergeWorker;
+
+/**
+ * @brief Runs this worker's share of the blocks or merges of one level.
+ *
+ * @param arg Pointer to the MergeWorker.
+ * @return NULL.
+ */
+static void *merge_worker(void *arg) {
+    MergeWorker *w = arg;
+    const MergeLevel *lv = w->level;
+    char buf[64];
+    char *tmp = element_tmp(lv->size, buf, sizeof(buf));
+    for (size_t task = (size_t) w->index; task < lv->tasks; task += (size_t) lv->threads) {
+        if (lv->run == 0) {
+            size_t start = task * lv->block;
+            size_t n = lv->len - start < lv->block ? lv->len - start : lv->block;
+            fisher_yates(lv->src + start * lv->size, n, lv->size, &w->rng, tmp);
+        } else {
+            size_t start = task * 2 * lv->run;
+            size_t mid = start + lv->run < lv->len ? start + lv->run : lv->len;
+            size_t end = start + 2 * lv->run < lv->len ? start + 2 * lv->run : lv->len;
+            merge_random(lv->src + start * lv->size, mid - start, lv->src + mid * lv->size, end - mid,
+                         lv->dst + start * lv->size, lv->size, &w->rng);
+        }
+    }
+    if (tmp != buf) {
+        free(tmp);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Shuffles an array uniformly with the merge shuffle, running the blocks and the merges of
+ * each level on several threads; N is ignored.
+ *
+ * Each worker has its own stream split off rng. The last levels have fewer merges than threads, so
+ * the final merge runs on one thread; everything before it is spread over all of them.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element.
+ * @param N Ignored.
+ * @param rng The random number generator.
+ */
+static void shuffle_merge_parallel_r(void *L, size_t len, size_t size, int N, Rng *rng) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int) cpus : 1;
+    if (threads == 1 || len * size < PARALLEL_MIN_BYTES) {
+        shuffle_merge_r(L, len, size, N, rng);
+        return;
+    }
+
+    char *work = malloc(len * size);
+    MergeWorker *workers = malloc(threads * sizeof(MergeWorker));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    if (work == NULL || workers == NULL || tids == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < threads; t++) {
+        workers[t].index = t;
+        rng_split(rng, &workers[t].rng);
+    }
+
+    MergeLevel level;
+    level.src = L;
+    level.dst = work;
+    level.len = len;
+    level.size = size;
+    level.block = merge_block_len(size);
+    level.run = 0;
+    level.tasks = (len + level.block - 1) / level.block;
+    level.threads = threads;
+    for (;;) {
+        // Worker 0 runs on the calling thread
+        for (int t = 0; t < threads; t++) {
+            workers[t].level = &level;
+        }
+        for (int t = 1; t < threads; t++) {
+            if (pthread_create(&tids[t], NULL, merge_worker, &workers[t]) != 0) {
+                fprintf(stderr, "Error: failed to create worker thread\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        merge_worker(&workers[0]);
+        for (int t = 1; t < threads; t++) {
+            pthread_join(tids[t], NULL);
+        }
+
+        if (level.run > 0) {
+            char *swap = level.src;
+            level.src = level.dst;
+            level.dst = swap;
+        }
+        level.run = level.run == 0 ? level.block : 2 * level.run;
+        if (level.run >= len) {
+            break;
+        }
+        level.tasks = (len + 2 * level.run - 1) / (2 * level.run);
+    }
+    if (level.src != (char *) L) {
+        memcpy(L, level.src, len * size);
+    }
+
+    free(tids);
+    free(workers);
+    free(work);
+}
+
+/**
+ * @brief Performs N overhand shuffles.
+ *
+ * In one overhand shuffle the deck is split into packets, cutting between each pair of neighbours
+ * with probability 1/2, and the packets are dealt onto a new pile, which reverses their order while
+ * keeping the order within each packet.
+ *
+ * @param L Pointer to the array.
+ * @param len Length of the array.
+ * @param size Size of each element.
+ * @param N Number of overhand shuffles.
+ * @param rng The random number generator.
+ */
+static void shuffle_overhand_r(void *L, size_t len, size_t size, int N, Rng *rng) {
+    if (len < 2) {
+        return;
+    }
+    char *work = malloc(len * size);
+    if (work == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *src = L;
+    char *dst = work;
+    for (int pass = 0; pass < N; pass++) {
+        size_t start = 0;
+        for (size_t i = 1; i <= len; i++) {
+            if (i == len || rng_bit(rng)) { // packet [start, i) ends here
+                memcpy(dst + (len - i) * size, src + start * size, (i - start) * size);
+                start = i;
+            }
+        }
+        char *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != (char *) L) {
+        memcpy(L, src, len * size);
+    }
+    free(work);
+}
+
+const ShuffleAlgorithm shuffle_riffle = {"riffle", riffle_r, 1};
+const ShuffleAlgorithm shuffle_fisher_yates = {"fisher_yates", shuffle_fisher_yates_r, 0};
+const ShuffleAlgorithm shuffle_merge = {"merge", shuffle_merge_r, 0};
+const ShuffleAlgorithm shuffle_merge_parallel = {"merge_parallel", shuffle_merge_parallel_r, 0};
+const ShuffleAlgorithm shuffle_overhand = {"overhand", shuffle_overhand_r, 1};
+
+const ShuffleAlgorithm *const shuffle_algorithms[] = {
+    &shuffle_riffle,
+    &shuffle_fisher_yates,
+    &shuffle_merge,
+    &shuffle_merge_parallel,
+    &shuffle_overhand,
+    NULL
+};
+
+/**
+ * @brief Looks up a shuffle algorithm by name.
+ *
+ * @param name The name, e.g. "riffle" or "fisher_yates".
+ * @return The algorithm, or NULL if there is none with that name.
+ */
+const ShuffleAlgorithm *shuffle_algorithm_find(const char *name) {
+    for (int i = 0; shuffle_algorithms[i] != NULL; i++) {
+        if (strcmp(shuffle_algorithms[i]->name, name) == 0) {
+            return shuffle_algorithms[i];
+        }
+    }
+    return NULL;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c shuffles.c -o shuffles.o
+ * this file implements the fisher_yates, merge, merge_parallel and overhand shuffles and shuffle_algorithm_find.
+ */
@@ -0,0 +1,181 @@
+/**
+ * @file stream_shuffle.c
+ * @brief A program that riffles a binary file of fixed-size records with riffle_file (or, with -m,
+ * riffle_file_mmap) and reports the throughput of every pass.
+ *
+ * With -g the file is first generated with the given number of records, each starting with its
+ * 64-bit index, and after shuffling the program checks that every index is still present once.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "riffle_stream.h"
+#include "rng.h"
+
+/**
+ * @brief Writes a test file of records numbered 0, 1, ..., records-1.
+ *
+ * @param path The file to write.
+ * @param records The number of records.
+ * @param record_size The size of each record in bytes (at least 8).
+ * @return 0 on success, -1 on failure.
+ */
+static int generate_file(const char *path, uint64_t records, size_t record_size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        perror("Failed to create file");
+        return -1;
+    }
+    char *record = calloc(1, record_size);
+    if (record == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int status = 0;
+    for (uint64_t i = 0; i < records && status == 0; i++) {
+        memcpy(record, &i, sizeof(i));
+        if (fwrite(record, record_size, 1, fp) != 1) {
+            status = -1;
+        }
+    }
+    free(record);
+    if (fclose(fp) != 0 || status != 0) {
+        perror("Failed to write file");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks that a generated file still holds every record index exactly once.
+ *
+ * @param path The file to check.
+ * @param records The number of records.
+ * @param record_size The size of each record in bytes.
+ * @return 1 if the file is a permutation of the generated records, 0 otherwise.
+ */
+static int verify_file(const char *path, uint64_t records, size_t record_size) {
+    FILE *fp = fopen(path, "rb");
+    unsigned char *seen = calloc(records / 8 + 1, 1);
+    char *record = malloc(record_size);
+    if (fp == NULL || seen == NULL || record == NULL) {
+        fprintf(stderr, "Error: cannot verify %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    int ok = 1;
+    uint64_t count = 0;
+    while (fread(record, record_size, 1, fp) == 1) {
+        uint64_t index;
+        memcpy(&index, record, sizeof(index));
+        if (index >= records || (seen[index / 8] & (1u << (index % 8)))) {
+            ok = 0;
+            break;
+        }
+        seen[index / 8] |= 1u << (index % 8);
+        count++;
+    }
+    fclose(fp);
+    free(seen);
+    free(record);
+    return ok && count == records;
+}
+
+/**
+ * @brief Main function for the streaming riffle program.
+ *
+ * @param argc The number of command line arguments
+ * @param argv An array of strings containing the command line arguments
+ * @return 0 on success, non-zero on failure.
+ */
+int main(int argc, char *argv[]) {
+    size_t record_size = 8;
+    int N = 7;
+    size_t buffer_size = 1 << 20;
+    uint64_t seed = (uint64_t) time(NULL);
+    uint64_t generate = 0;
+    int use_mmap = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            record_size = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            N = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            buffer_size = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            generate = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            use_mmap = 1;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || record_size == 0 || N < 1 || (generate > 0 && record_size < 8)) {
+        printf("Usage: stream_shuffle [-m] [-r record_bytes] [-n riffles] [-b buffer_bytes] [-s seed] [-g records] file\n");
+        printf("  -m riffles through memory mappings instead of buffered reads and writes (-b is ignored)\n");
+        printf("  -g writes a test file of numbered records first (record_bytes >= 8) and verifies it afterwards\n");
+        return 1;
+    }
+
+    if (generate > 0 && generate_file(path, generate, record_size) != 0) {
+        return 1;
+    }
+
+    RiffleFilePass *passes = malloc(N * sizeof(RiffleFilePass));
+    if (passes == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        return 1;
+    }
+    Rng rng;
+    rng_seed(&rng, seed);
+    int status = use_mmap ? riffle_file_mmap(path, record_size, N, &rng, passes)
+                          : riffle_file(path, record_size, N, buffer_size, &rng, passes);
+    if (status != 0) {
+        free(passes);
+        return 1;
+    }
+
+    printf("pass\tseconds\tMB/s\n");
+    double total = 0.0;
+    for (int i = 0; i < N; i++) {
+        printf("%d\t%.3f\t%.1f\n", i + 1, passes[i].seconds, passes[i].mb_per_s);
+        total += passes[i].seconds;
+    }
+    printf("total\t%.3f\n", total);
+    free(passes);
+
+    if (generate > 0) {
+        int ok = verify_file(path, generate, record_size);
+        printf("Check shuffled file: %s\n", ok ? "PASS" : "FAIL");
+        return ok ? 0 : 1;
+    }
+    return 0;
+}
+
+/* Instructions for running the program:
+ * To compile the program, run the following command in the terminal:
+ * gcc -c rng.c -o rng.o
+ * gcc -c riffle.c -o riffle.o
+ * gcc -c metrics.c -o metrics.o
+ * gcc -c shuffles.c -o shuffles.o
+ * gcc -c perm_stats.c -o perm_stats.o
+ * gcc -c riffle_stream.c -o riffle_stream.o
+ * gcc riffle.o shuffles.o metrics.o perm_stats.o rng.o riffle_stream.o stream_shuffle.c -pthread -lm -o stream_shuffle
+ *
+ * To run the program, type the following command:
+ * ./stream_shuffle -g 10000000 -r 16 -n 7 records.bin
+ * ./stream_shuffle -m -n 7 -r 16 records.bin
+ *
+ * The program will shuffle records.bin in place and print the time and MB/s of every pass.
+ */